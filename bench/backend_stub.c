@@ -0,0 +1,19 @@
+/**
+ * @file backend_stub.c
+ * @brief No-op pigpiod_if2 backend for call_overhead_bench
+ *
+ * Every call succeeds without touching the daemon, so the benchmark measures only
+ * the library side of a call
+*/
+
+#include <pigpiod_if2.h>
+
+int set_mode(int pi, unsigned gpio, unsigned mode) { (void)pi; (void)gpio; (void)mode; return 0; }
+int set_pull_up_down(int pi, unsigned gpio, unsigned pud) { (void)pi; (void)gpio; (void)pud; return 0; }
+int gpio_read(int pi, unsigned gpio) { (void)pi; (void)gpio; return 0; }
+int set_PWM_frequency(int pi, unsigned user_gpio, unsigned frequency) { (void)pi; (void)user_gpio; return (int)frequency; }
+int set_PWM_range(int pi, unsigned user_gpio, unsigned range_) { (void)pi; (void)user_gpio; return (int)range_; }
+int set_PWM_dutycycle(int pi, unsigned user_gpio, unsigned dutycycle) { (void)pi; (void)user_gpio; (void)dutycycle; return 0; }
+int callback_ex(int pi, unsigned user_gpio, unsigned edge, CBFuncEx_t f, void* userdata) { (void)pi; (void)user_gpio; (void)edge; (void)f; (void)userdata; return 0; }
+int callback_cancel(unsigned callback_id) { (void)callback_id; return 0; }
+uint32_t get_current_tick(int pi) { (void)pi; return 0; }
@@ -0,0 +1,52 @@
+/**
+ * @file call_overhead_bench.cpp
+ * @brief Per-call overhead of the C API against the header-only C++ layer (mecanum.hpp)
+ *
+ * Built against a no-op backend (backend_stub.c) instead of pigpiod_if2, so the numbers
+ * are the library cost of a call without the daemon round trip
+ *
+ * usage: call_overhead_bench [iterations]
+*/
+
+#include "mecanum/mecanum.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+template <typename F>
+double ns_per_call(unsigned long iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; ++i) f(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations);
+}
+
+volatile int32_t sink;
+
+} //namespace
+
+int main(int argc, char** argv) {
+    unsigned long iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000UL;
+    if (iterations == 0) iterations = 10000000UL;
+    const int pi = 0;
+
+    (void)init_wheel(pi, &WHEELS[0]);
+    (void)init_encoder(pi, &ENCODERS[0], X4);
+    mecanum::WheelAt<0> wheel(pi);
+    mecanum::EncoderAt<0, X4> encoder(pi);
+
+    double cForward = ns_per_call(iterations, [&](unsigned long i) { (void)forward(pi, &WHEELS[0], static_cast<unsigned int>(i)); });
+    double cppForward = ns_per_call(iterations, [&](unsigned long i) { (void)wheel.forward(static_cast<unsigned int>(i)); });
+    double cPosition = ns_per_call(iterations, [&](unsigned long) { sink = get_position(&ENCODERS[0]); });
+    double cppPosition = ns_per_call(iterations, [&](unsigned long) { sink = encoder.position(); });
+
+    std::printf("%lu iterations, no-op backend\n", iterations);
+    std::printf("forward       C API %6.2f ns/call   C++ %6.2f ns/call\n", cForward, cppForward);
+    std::printf("get_position  C API %6.2f ns/call   C++ %6.2f ns/call\n", cPosition, cppPosition);
+
+    (void)deinit_encoder(pi, &ENCODERS[0], true);
+    return 0;
+}
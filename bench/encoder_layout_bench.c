@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+
+/**
+ * @file encoder_layout_bench.c
+ * @brief Reader/writer contention on the encoder state, packed layout vs cache-line layout
+ *
+ * One writer thread per wheel plays the pigpiod callback thread (position/tick/prevState on every edge),
+ * one reader thread plays the control loop (positions of all wheels). Both count their iterations
+ * Does not talk to the daemon
+ *
+ * usage: encoder_layout_bench [seconds]
+*/
+
+#include "mecanum/encoder.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+/* Layout before the hot/cold split (about 28 bytes per encoder, several encoders per cache line) */
+typedef struct {
+    const EncoderGPIO encoder;
+    EncoderMultiplication mode;
+    volatile int32_t position;
+    volatile uint32_t tick;
+    int callback_id_a;
+    int callback_id_b;
+    uint8_t prevState;
+    bool initialized;
+    const uint8_t index;
+} PackedEncoderInfo;
+
+static PackedEncoderInfo packed[ROBOT_MANAGED_WHEEL_COUNT];
+static EncoderInfo aligned[ROBOT_MANAGED_WHEEL_COUNT];
+
+static atomic_bool running;
+
+typedef struct {
+    bool useAligned;
+    unsigned int wheel;
+    uint64_t iterations;
+} BenchThread;
+
+static void* writer(void* arg) {
+    BenchThread* bt = (BenchThread*)arg;
+    uint64_t n = 0;
+    uint32_t tick = 0;
+
+    if (bt->useAligned) {
+        EncoderState* st = &aligned[bt->wheel].state;
+        while (atomic_load_explicit(&running, memory_order_relaxed)) {
+            st->position += 1;
+            st->tick = ++tick;
+            st->prevState = (uint8_t)(tick & MASK_LOWER2);
+            ++n;
+        }
+    }
+    else {
+        PackedEncoderInfo* ei = &packed[bt->wheel];
+        while (atomic_load_explicit(&running, memory_order_relaxed)) {
+            ei->position += 1;
+            ei->tick = ++tick;
+            ei->prevState = (uint8_t)(tick & MASK_LOWER2);
+            ++n;
+        }
+    }
+    bt->iterations = n;
+    return NULL;
+}
+
+static void* reader(void* arg) {
+    BenchThread* bt = (BenchThread*)arg;
+    uint64_t n = 0;
+    int32_t sink = 0;
+
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+            sink += bt->useAligned ? aligned[i].state.position : packed[i].position;
+        }
+        ++n;
+    }
+    bt->iterations = n;
+    return (void*)(intptr_t)sink;
+}
+
+static void run(bool useAligned, double seconds) {
+    pthread_t threads[ROBOT_MANAGED_WHEEL_COUNT + 1];
+    BenchThread args[ROBOT_MANAGED_WHEEL_COUNT + 1];
+
+    atomic_store(&running, true);
+    for (unsigned int i = 0; i <= ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+        args[i] = (BenchThread){.useAligned = useAligned, .wheel = i, .iterations = 0};
+        (void)pthread_create(&threads[i], NULL, i < ROBOT_MANAGED_WHEEL_COUNT ? writer : reader, &args[i]);
+    }
+
+    struct timespec ts = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9)};
+    (void)nanosleep(&ts, NULL);
+    atomic_store(&running, false);
+
+    uint64_t writes = 0;
+    for (unsigned int i = 0; i <= ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+        (void)pthread_join(threads[i], NULL);
+        if (i < ROBOT_MANAGED_WHEEL_COUNT) writes += args[i].iterations;
+    }
+    printf("%-8s sizeof=%3zu  writer %8.2f Mupdates/s  reader %8.2f Mscans/s\n",
+           useAligned ? "aligned" : "packed",
+           useAligned ? sizeof(EncoderInfo) : sizeof(PackedEncoderInfo),
+           (double)writes / seconds / 1e6,
+           (double)args[ROBOT_MANAGED_WHEEL_COUNT].iterations / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    if (seconds <= 0.0) seconds = 1.0;
+
+    printf("%u wheels, %u writer threads + 1 reader thread, %.1f s each\n", ROBOT_MANAGED_WHEEL_COUNT, ROBOT_MANAGED_WHEEL_COUNT, seconds);
+    run(false, seconds);
+    run(true, seconds);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_CALIBRATION_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_CALIBRATION_H_
+
+#include "mecanum/wheel_control.h"
+#include "mecanum/encoder.h"
+
+/**
+ * @file calibration.h
+ * @brief Per-wheel duty to speed calibration and feed-forward speed commands
+ *
+ * calibrate_wheel() sweeps the duty of a wheel and measures the steady-state speed on its encoder.
+ * The result is kept as an inverse table (speed -> duty) per direction, so a speed command costs
+ * one table interpolation. Speeds are in encoder pulses per second (position / multiplier), which
+ * keeps the tables valid when the multiplication mode changes
+*/
+
+/* Constants */
+#define CALIBRATION_STEPS 32U             //Duty points swept per direction
+#define CALIBRATION_LUT_SIZE 64U          //Entries of the inverse table
+#define CALIBRATION_SETTLE_MS 300U        //Wait after a duty change before measuring
+#define CALIBRATION_MEASURE_MS 200U       //Measurement interval per duty point
+#define CALIBRATION_MIN_SPEED 1.0f        //Slowest speed (pulses/s) treated as moving
+#define CALIBRATION_FILE_MAGIC 0x4C41434DU //"MCAL"
+#define CALIBRATION_FILE_VERSION 1U
+
+typedef enum {DIRECTION_FORWARD = 0, DIRECTION_REVERSE = 1} WheelDirection;
+
+/**
+ * @struct SpeedTable
+ * @brief Inverse table of one direction: duty[i] reaches speed i * max_speed / (CALIBRATION_LUT_SIZE - 1)
+*/
+typedef struct {
+    float max_speed;                     //Speed at DUTYCYCLE_RANGE (pulses/s)
+    float scale;                         //(CALIBRATION_LUT_SIZE - 1) / max_speed (Internal use only)
+    uint16_t duty[CALIBRATION_LUT_SIZE]; //duty[0] is the end of the deadband
+} SpeedTable;
+
+/**
+ * @struct WheelCalibration
+ * @brief Calibration of one wheel
+*/
+typedef struct {
+    SpeedTable table[2]; //Indexed by WheelDirection
+    bool calibrated;     //Calibration status
+} WheelCalibration;
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+extern WheelCalibration CALIBRATIONS[ROBOT_MANAGED_WHEEL_COUNT];
+
+/**
+ * @brief Look up the feed-forward duty for a speed
+ *
+ * @param table Table of the direction to drive
+ * @param speed Absolute speed (pulses/s)
+ * @return Duty (0 to DUTYCYCLE_RANGE), 0 for a zero speed
+*/
+static inline unsigned int feedforward_duty(const SpeedTable* table, float speed) {
+    if (speed <= 0.0f) return 0;
+
+    float x = speed * table->scale;
+    if (x >= (float)(CALIBRATION_LUT_SIZE - 1U)) return table->duty[CALIBRATION_LUT_SIZE - 1U];
+
+    unsigned int i = (unsigned int)x;
+    float frac = x - (float)i;
+    return table->duty[i] + (unsigned int)((float)(table->duty[i + 1U] - table->duty[i]) * frac + 0.5f);
+}
+
+/**
+ * @brief Sweep the duty of a wheel in both directions and build its tables
+ *
+ * Blocks for about 2 * CALIBRATION_STEPS * (CALIBRATION_SETTLE_MS + CALIBRATION_MEASURE_MS)
+ * The wheel must be free to turn; it is left idle afterwards
+ *
+ * @param pi pigpiod demon handle
+ * @param wheel Target wheel motor driver (e.g WHEELS[0])
+ * @param encoder Encoder of the same wheel (e.g ENCODERS[0])
+ * @param out Receives the calibration (e.g CALIBRATIONS[0])
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
+*/
+int calibrate_wheel(int pi, const MotorDriveInfo* wheel, const EncoderInfo* encoder, WheelCalibration* out);
+
+/**
+ * @brief Invert a measured duty -> speed curve into a speed -> duty table
+ *
+ * The curve is made non-decreasing first; duty[0] is the highest swept duty still below CALIBRATION_MIN_SPEED
+ *
+ * @param speed Speed (pulses/s) at duty k * DUTYCYCLE_RANGE / CALIBRATION_STEPS, speed[0] is duty 0
+ * @param table Receives the table
+*/
+void build_speed_table(const float speed[CALIBRATION_STEPS + 1U], SpeedTable* table);
+
+/**
+ * @brief Save CALIBRATIONS[] to a binary file
+ *
+ * @param path File path
+ * @return RC_OK if OK, otherwise RC_INVALID_OPERATION
+*/
+int save_calibration(const char* path);
+
+/**
+ * @brief Load CALIBRATIONS[] from a binary file written by save_calibration()
+ *
+ * CALIBRATIONS[] is left untouched if the file is missing or does not match this build
+ *
+ * @param path File path
+ * @return RC_OK if OK, otherwise RC_INVALID_OPERATION
+*/
+int load_calibration(const char* path);
+
+/**
+ * @brief Drive a wheel at a speed using its calibration as feed-forward
+ *
+ * @param pi pigpiod demon handle
+ * @param target Target wheel motor driver (e.g WHEELS[0])
+ * @param cal Calibration of the wheel (e.g CALIBRATIONS[0])
+ * @param speed Speed in pulses/s, positive for forward(), negative for reverse(), 0 for idle()
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
+*/
+int set_wheel_speed(int pi, const MotorDriveInfo* target, const WheelCalibration* cal, float speed);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_CALIBRATION_H_
@@ -14,7 +14,11 @@
 #endif //DEBUG
 
 #define NUM_WIRES_PER_WHEEL 2U
-#define ROBOT_MANAGED_WHEEL_COUNT 4U
+#ifndef ROBOT_MANAGED_WHEEL_COUNT
+  #define ROBOT_MANAGED_WHEEL_COUNT 4U  //Must match the entries of WHEEL_GPIO_TABLE and ENCODER_GPIO_TABLE
+#endif //ROBOT_MANAGED_WHEEL_COUNT
+
+#define CACHE_LINE_SIZE 64U
 
 #define GPIO_UNASSIGNED 0U
 
@@ -27,18 +31,25 @@
 #define RC_UNINITIALIZED -2
 #define RC_UNKNOWN_MODE -3
 #define RC_FAIL_DAEMON_CONNECT -4
+#define RC_DAEMON_DISCONNECTED -5
 
 #define LOCALHOST NULL
 #define DEFAULT_PORT NULL
 
 #if defined(__GNUC__) || defined(__clang__)
-  #define likely(x) __builtin_expect(!!x, 1)
-  #define unlikely(x) __builtin_expect(!!x, 0)
+  #define likely(x) __builtin_expect(!!(x), 1)
+  #define unlikely(x) __builtin_expect(!!(x), 0)
 #else 
   #define likely(x) !!(x)
   #define unlikely(x) !!(x)
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+  #define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#else
+  #define CACHE_ALIGNED
+#endif
+
 #define UNUSED_PARAMETER(x) (void)x
 
 #endif //LMP_PROJECT_HARDWARE_MECANUM_CONFIG_H_
@@ -7,8 +7,37 @@
  * @file daemon.h
  * @brief Provides connection management to the pigpiod daemon
  *
+ * pigpiod_if2 writes to the daemon socket without MSG_NOSIGNAL. Once the daemon has dropped, the
+ * next command would raise SIGPIPE and terminate the process before RC_DAEMON_DISCONNECTED can be
+ * handled. pigpiod_daemon_open() and pigpiod_daemon_reopen() therefore set SIGPIPE to SIG_IGN
+ * unless the application has installed its own disposition. Applications that connect with
+ * pigpio_start() directly must ignore SIGPIPE themselves
 */
 
+/* Constants */
+#define RECONNECT_BACKOFF_INITIAL_US 1000U    //First retry delay
+#define RECONNECT_BACKOFF_MAX_US 200000U      //Upper bound of the retry delay
+#define RECONNECT_MAX_ATTEMPTS 50U            //Give up after this many failed attempts
+
+/**
+ * @brief Check whether a pigpiod return code means the socket to the daemon is lost
+ *
+ * @param rc Return code of a pigpiod_if2 function
+ * @return true if the connection has to be re-established
+*/
+static inline bool pigpiod_daemon_lost(int rc) {
+    return rc == pigif_bad_send || rc == pigif_bad_recv || rc == pigif_unconnected_pi;
+}
+
+/**
+ * @brief Map a failed pigpiod_if2 return code to a library return code
+ *
+ * @param rc Negative return code of a pigpiod_if2 function
+ * @return RC_DAEMON_DISCONNECTED if the connection is lost, otherwise RC_INVALID_OPERATION
+*/
+static inline int pigpiod_error_rc(int rc) {
+    return pigpiod_daemon_lost(rc) ? RC_DAEMON_DISCONNECTED : RC_INVALID_OPERATION;
+}
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +52,7 @@ extern "C" {
  *             Pass NULL or DEFAULT_PORT for the default port.
  *
  * @return >= 0 if OK (pigpiod handle), otherwise RC_FAIL_DAEMON_CONNECT 
+ * @note Sets SIGPIPE to SIG_IGN if it still has the default disposition
 */
 int pigpiod_daemon_open(const char* addr, const char* port);
 
@@ -33,6 +63,18 @@ int pigpiod_daemon_open(const char* addr, const char* port);
 */
 void pigpiod_daemon_close(int pi);
 
+/**
+ * @brief Drop the handle and connect again to the daemon given to pigpiod_daemon_open()
+ *
+ * Retries with exponential backoff (RECONNECT_BACKOFF_INITIAL_US doubling up to RECONNECT_BACKOFF_MAX_US)
+ * Only the socket is restored; use recover_daemon() (recovery.h) to replay the GPIO state as well
+ *
+ * @param pi The handle to drop (a negative value skips the close)
+ * @param attempts Receives the number of connection attempts (may be NULL)
+ * @return >= 0 if OK (new pigpiod handle), otherwise RC_FAIL_DAEMON_CONNECT
+*/
+int pigpiod_daemon_reopen(int pi, unsigned int* attempts);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
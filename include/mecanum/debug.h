@@ -6,6 +6,12 @@
 #include <string.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+  #define DEBUG_THREAD_LOCAL thread_local
+#else
+  #define DEBUG_THREAD_LOCAL _Thread_local
+#endif //__cplusplus
+
 static inline const char* get_wheel_name(uint8_t bit) {
 	switch (bit) {
 		    case 0:
@@ -16,8 +22,12 @@ static inline const char* get_wheel_name(uint8_t bit) {
 		        return "RL";
 		    case 3:
 		        return "RR";
-		    default:
-		        return NULL;
+		    default: {
+		        //wheels beyond the four corners (ROBOT_MANAGED_WHEEL_COUNT > 4) are named by index
+		        static DEBUG_THREAD_LOCAL char name[8];
+		        (void)snprintf(name, sizeof(name), "W%u", (unsigned int)bit);
+		        return name;
+		    }
 		}
 
 }
@@ -32,8 +42,11 @@ static inline const char* get_encoder_name(uint8_t bit) {
             return "ERL";
         case 3:
             return "ERR";
-        default:
-            return NULL;
+        default: {
+            static DEBUG_THREAD_LOCAL char name[8];
+            (void)snprintf(name, sizeof(name), "E%u", (unsigned int)bit);
+            return name;
+        }
     }
 }
 
@@ -14,6 +14,8 @@
 /* Constants */
 #define MASK_LOWER2 0x3
 #define MIN_PULSE_US 50  //Use it to avoid chattering
+#define ADAPTIVE_EDGE_RATE_HIGH 10000U //XADAPTIVE: callback edges/s above which the next coarser mode is used
+#define ADAPTIVE_EDGE_RATE_LOW 5000U   //XADAPTIVE: the finer mode is used again once its edge rate would stay below this
 
 /* GPIO Configuration */
 #define ENCODER_FRONT_LEFT_CH_A GPIO_UNASSIGNED
@@ -28,6 +30,13 @@
 #define ENCODER_REAR_RIGHT_CH_A GPIO_UNASSIGNED
 #define ENCODER_REAR_RIGHT_CH_B GPIO_UNASSIGNED
 
+/* Encoder table: X(index, channel A, channel B), one entry per ROBOT_MANAGED_WHEEL_COUNT */
+#define ENCODER_GPIO_TABLE(X) \
+    X(0, ENCODER_FRONT_LEFT_CH_A, ENCODER_FRONT_LEFT_CH_B) \
+    X(1, ENCODER_FRONT_RIGHT_CH_A, ENCODER_FRONT_RIGHT_CH_B) \
+    X(2, ENCODER_REAR_LEFT_CH_A, ENCODER_REAR_LEFT_CH_B) \
+    X(3, ENCODER_REAR_RIGHT_CH_A, ENCODER_REAR_RIGHT_CH_B)
+
 /**
  * @enum EncoderMultiplication
  * @brief Specifies the multiplication mode for the encoder
@@ -35,8 +44,10 @@
  * -X1: count on rising edge (or falling edge) of one channel
  * -X2: count on both edge of one channel
  * -X4: count on both edge of both channels
+ * -XADAPTIVE: switch between X4, X2 and X1 by edge rate (see update_encoder_mode()),
+ *             the position is always counted in X4 units
 */
-typedef enum {UNSET = 0, X1 = 1 , X2 = 2, X4 = 4} EncoderMultiplication;
+typedef enum {UNSET = 0, X1 = 1 , X2 = 2, X4 = 4, XADAPTIVE = 0x10} EncoderMultiplication;
 
 /**
  * @struct EncoderGPIO
@@ -47,41 +58,91 @@ typedef struct {
     unsigned int chb; //channel B
 } EncoderGPIO;
 
-#ifdef DEBUG
 /**
- * @struct EncoderInfo
- * @brief Encoder information with debug index
+ * @struct EncoderState
+ * @brief Counters written by the callback thread on every edge
+ *
+ * Occupies a cache line of its own so that edges on one wheel do not invalidate
+ * the lines other threads read for the remaining wheels
 */
 typedef struct {
-    const EncoderGPIO encoder;  //encoder pins
-    EncoderMultiplication mode; //Multiplication mode (X1, X2, or X4)  
     volatile int32_t position;  //Accumulated position
     volatile uint32_t tick;     //Timestamp of last tick (Internal use only)
-    int callback_id_a;          //callback id 
-    int callback_id_b;          //callback id 
     uint8_t prevState;          //Previous status (bit1 = A, bit0 = B) (Internal use only)
-    bool initialized;           //Initialization status
-    const uint8_t index;        //Encoder index (use debug)
-} EncoderInfo;
+    int8_t direction;           //Sign of the last counted step, XADAPTIVE only (Internal use only)
+} CACHE_ALIGNED EncoderState;
+
+/**
+ * @struct EncoderAdaptive
+ * @brief Edge rate tracking of an XADAPTIVE encoder
+ *
+ * Written by the control thread every cycle, so it gets a cache line of its own as well
+*/
+typedef struct {
+    int32_t position;           //Position at the last update_encoder_mode() (Internal use only)
+    int64_t time_ns;            //Time of the last update_encoder_mode() (Internal use only)
+    uint64_t residency_ns[3];   //Time spent in X1, X2 and X4 (ns, read with get_mode_residency())
+} CACHE_ALIGNED EncoderAdaptive;
 
-#else
 /**
  * @struct EncoderInfo
- * @brief Encoder information (release version)
+ * @brief Encoder information
  *
+ * Hot counters first, the configuration written only by init/deinit (and XADAPTIVE switches) follows
+ * on the next cache line, the XADAPTIVE rate tracking on the one after
 */
 typedef struct {
+    EncoderState state;         //Hot counters (Internal use only, read with get_position())
     const EncoderGPIO encoder;  //encoder pins
-    EncoderMultiplication mode; //Multiplication mode (X1, X2, or X4)
-    volatile int32_t position;  //Accumulated position
-    volatile uint32_t tick;     //Timestamp of last tick (Internal use only)
+    volatile EncoderMultiplication mode; //Multiplication mode (X1, X2, or X4), the active one for XADAPTIVE
     int callback_id_a;          //callback id
     int callback_id_b;          //callback id
-    uint8_t prevState;          //Previous status (bit1 = A, bit0 = B) (Internal use only)
+    bool adaptive;              //Initialized with XADAPTIVE
     bool initialized;           //Initialization status
+    const uint8_t index;        //Encoder index (ENCODERS[index])
+    EncoderAdaptive rate;       //Edge rate tracking (XADAPTIVE only)
 } EncoderInfo;
 
-#endif //DEBUG
+/**
+ * @brief Position of a quadrature state within one cw cycle (00 -> 10 -> 11 -> 01)
+ *
+ * @param state bit1 = A, bit0 = B
+ * @return 0 to 3
+*/
+static inline int encoder_phase(uint8_t state) {
+    int levelA = (state >> 1) & 1;
+    int levelB = state & 1;
+    return (levelB << 1) | (levelA ^ levelB);
+}
+
+/**
+ * @brief Take over the quadrature state read after a reconnect (used by restore_encoder() and mecanum.hpp)
+ *
+ * X4 counts a single step missed during the outage. X2 can only see a change of channel A, X1 only
+ * a rise of it; a falling A edge is not counted in X1 and missed full cycles are not visible in the levels
+ *
+ * @param state Counters of the encoder, prevState is the state at the last counted edge
+ * @param mode Counting mode (X4 for XADAPTIVE, which counts in X4 units)
+ * @param levelA Current level of channel A
+ * @param levelB Current level of channel B
+ * @return true if counted edges were lost while disconnected
+*/
+static inline bool encoder_resync_state(EncoderState* state, EncoderMultiplication mode, int levelA, int levelB) {
+    uint8_t prev = state->prevState;
+    uint8_t current = (uint8_t)(((levelA << 1) | levelB) & MASK_LOWER2);
+
+    state->prevState = current;
+    if (current == prev) return false;
+    if (mode == X4) {
+        int steps = (encoder_phase(current) - encoder_phase(prev)) & MASK_LOWER2;
+        if (steps == 2) return true;
+        state->position = state->position + (steps == 1 ? 1 : -1);
+        return false;
+    }
+    int prevA = prev >> 1;
+    int currentA = current >> 1;
+    return mode == X2 ? prevA != currentA : (prevA == LOW && currentA == HIGH);
+}
 
 #ifdef  __cplusplus
 extern "C" {
@@ -94,8 +155,8 @@ extern EncoderInfo ENCODERS[ROBOT_MANAGED_WHEEL_COUNT];
  *
  * @param pi pigpiod demon handle
  * @param target Target encoder (e.g ENCODERS[0])
- * @param mode Multiplication mode (X1, X2, or X4)
- * @return RC_OK if OK, otherwise RC_ALREADY_INITIALIZED or RC_UNKNOWN_MODE or RC_INVALID_OPERATION
+ * @param mode Multiplication mode (X1, X2, X4, or XADAPTIVE)
+ * @return RC_OK if OK, otherwise RC_ALREADY_INITIALIZED or RC_UNKNOWN_MODE or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
 */
 int init_encoder(int pi, EncoderInfo* target, EncoderMultiplication mode);
 
@@ -109,6 +170,21 @@ int init_encoder(int pi, EncoderInfo* target, EncoderMultiplication mode);
 */
 int deinit_encoder(int pi, EncoderInfo* target, bool cleared);
 
+/**
+ * @brief Re-apply pin setup and re-register the callbacks on a new daemon connection
+ *
+ * The accumulated position is kept. The quadrature state is re-read and compared with the state at
+ * the last counted edge (see encoder_resync_state()): a single X4 step missed during the outage is
+ * counted, edges that cannot be counted are reported through edgeGap
+ * Does nothing for an encoder that has not been initialized
+ *
+ * @param pi pigpiod demon handle (after reconnect)
+ * @param target Target encoder (e.g ENCODERS[0])
+ * @param edgeGap Set to true if edges were lost while disconnected (may be NULL)
+ * @return RC_OK if OK, otherwise RC_INVALID_OPERATION or RC_DAEMON_DISCONNECTED
+*/
+int restore_encoder(int pi, EncoderInfo* target, bool* edgeGap);
+
 /**
  * @brief Get the current position of an encoder
  *
@@ -129,9 +205,30 @@ void set_position(EncoderInfo* target, int32_t val);
  * @brief Get the encoder multiplier
  * 
  * @ param target Target encoder (e.g ENCODERS[0])
- * @return Encoder multiplier (1, 2, or 4)
+ * @return Encoder multiplier (1, 2, or 4; 4 for XADAPTIVE)
 */
 int get_multiplier(const EncoderInfo* target);
+
+/**
+ * @brief Re-select the multiplication mode of an XADAPTIVE encoder from its edge rate
+ *
+ * Call periodically from the control loop (e.g. every cycle). Steps to the next coarser mode when
+ * the callback edge rate exceeds ADAPTIVE_EDGE_RATE_HIGH, and back to the finer one when its rate
+ * would stay below ADAPTIVE_EDGE_RATE_LOW. Does nothing for a fixed mode
+ *
+ * @param pi pigpiod demon handle
+ * @param target Target encoder (e.g ENCODERS[0])
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
+*/
+int update_encoder_mode(int pi, EncoderInfo* target);
+
+/**
+ * @brief Get the time an XADAPTIVE encoder has spent in each mode
+ *
+ * @param target Target encoder (e.g ENCODERS[0])
+ * @param residencyUs Receives the time in X1, X2 and X4 (microseconds)
+*/
+void get_mode_residency(const EncoderInfo* target, uint64_t residencyUs[3]);
 #ifdef __cplusplus
 }
 #endif //__cplusplus
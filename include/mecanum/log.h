@@ -0,0 +1,121 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_LOG_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_LOG_H_
+
+#include "mecanum/config.h"
+#include <stdio.h>
+
+/**
+ * @file log.h
+ * @brief Asynchronous binary event log for the hot paths
+ *
+ * log_event() stores a fixed-size record in a lock-free ring owned by the calling thread and
+ * returns; a background thread started by start_logger() formats or dumps the records with a
+ * per-event rate limit. Before start_logger() (or after stop_logger()) events are formatted
+ * synchronously to stderr, as debug_log() does
+ *
+ * A thread gets its ring (about LOG_RING_SIZE * 16 bytes) on its first event. Rings are not freed;
+ * when the thread exits its ring is taken over by the next thread that logs, so memory grows with
+ * the number of threads logging at the same time, not with thread churn
+*/
+
+/* Constants */
+#define LOG_RING_SIZE 256U            //Events per thread ring (power of two)
+#define LOG_RATE_LIMIT 50U            //Events per event id and second written by the logger thread
+#define LOG_POLL_INTERVAL_MS 10U      //Logger thread sleep when all rings are empty
+#define LOG_FILE_MAGIC 0x474F4C4DU    //"MLOG"
+#define LOG_FILE_VERSION 1U
+
+/**
+ * @enum LogEventId
+ * @brief Event ids (stored in LogEvent.event)
+*/
+typedef enum {
+    LOG_WHEEL_UNINITIALIZED = 1, //Wheel used before init_wheel() (index, in1, in2)
+    LOG_WHEEL_PWM_FAILED,        //set_PWM_dutycycle() failed (index, in1, in2, rc)
+    LOG_EVENT_SUPPRESSED,        //Rate limit summary (index = suppressed event id, rc = count)
+    LOG_EVENT_COUNT
+} LogEventId;
+
+/**
+ * @enum LogFormat
+ * @brief Output of the logger thread
+ *
+ * -LOG_FORMAT_TEXT: one formatted line per event
+ * -LOG_FORMAT_BINARY: file header followed by raw LogEvent records (read with mecanum_log_decode)
+*/
+typedef enum {LOG_FORMAT_TEXT = 0, LOG_FORMAT_BINARY = 1} LogFormat;
+
+/**
+ * @struct LogEvent
+ * @brief One log record (16 bytes)
+*/
+typedef struct {
+    uint64_t time_ns; //CLOCK_MONOTONIC
+    int32_t rc;       //Return code
+    uint8_t event;    //LogEventId
+    uint8_t index;    //Wheel or encoder index
+    uint8_t pin_a;    //in1 or channel A
+    uint8_t pin_b;    //in2 or channel B
+} LogEvent;
+
+/**
+ * @struct LogFileHeader
+ * @brief Header of a LOG_FORMAT_BINARY file
+*/
+typedef struct {
+    uint32_t magic;       //LOG_FILE_MAGIC
+    uint16_t version;     //LOG_FILE_VERSION
+    uint16_t record_size; //sizeof(LogEvent)
+} LogFileHeader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+/**
+ * @brief Start the logger thread
+ *
+ * @param fp Output stream (opened in binary mode for LOG_FORMAT_BINARY)
+ * @param format LOG_FORMAT_TEXT or LOG_FORMAT_BINARY
+ * @return RC_OK if OK, otherwise RC_ALREADY_INITIALIZED or RC_INVALID_OPERATION
+*/
+int start_logger(FILE* fp, LogFormat format);
+
+/**
+ * @brief Write the remaining events and stop the logger thread
+*/
+void stop_logger(void);
+
+/**
+ * @brief Record an event without blocking
+ *
+ * Drops the event if the ring of the calling thread is full (see get_log_dropped())
+ *
+ * @param event LogEventId
+ * @param index Wheel or encoder index
+ * @param pinA in1 or channel A
+ * @param pinB in2 or channel B
+ * @param rc Return code
+*/
+void log_event(LogEventId event, uint8_t index, unsigned int pinA, unsigned int pinB, int rc);
+
+/**
+ * @brief Format an event as a text line
+ *
+ * @param ev Event
+ * @param buf Output buffer
+ * @param len Size of buf
+ * @return Result of snprintf()
+*/
+int format_log_event(const LogEvent* ev, char* buf, size_t len);
+
+/**
+ * @brief Get the number of events dropped because a ring was full
+*/
+uint64_t get_log_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_LOG_H_
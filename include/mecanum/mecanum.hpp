@@ -0,0 +1,341 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_MECANUM_HPP_
+#define LMP_PROJECT_HARDWARE_MECANUM_MECANUM_HPP_
+
+#include "mecanum/wheel_control.h"
+#include "mecanum/encoder.h"
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+/**
+ * @file mecanum.hpp
+ * @brief Header-only C++17 layer over the wheel and encoder modules
+ *
+ * Pins, multiplication mode and wheel count are template parameters. Objects are initialized in
+ * the constructor and released in the destructor, so the hot-path calls need no initialization
+ * check or mode dispatch and inline down to the pigpiod_if2 calls. Return codes are the RC_ values
+ * of the C API. The C API (WHEELS[], ENCODERS[]) and these objects must not drive the same pins
+ *
+ * recover_daemon() only replays WHEELS[] and ENCODERS[]. After it returns a new handle, call
+ * restore() on every object (or Platform::restore()) before using them again
+*/
+
+namespace mecanum {
+
+#define MECANUM_WHEEL_PINS(i, a, b) MotorDriveGPIO{a, b},
+#define MECANUM_ENCODER_PINS(i, a, b) EncoderGPIO{a, b},
+
+/* Pin maps generated from WHEEL_GPIO_TABLE / ENCODER_GPIO_TABLE */
+inline constexpr std::array<MotorDriveGPIO, ROBOT_MANAGED_WHEEL_COUNT> WHEEL_PINS = {{WHEEL_GPIO_TABLE(MECANUM_WHEEL_PINS)}};
+inline constexpr std::array<EncoderGPIO, ROBOT_MANAGED_WHEEL_COUNT> ENCODER_PINS = {{ENCODER_GPIO_TABLE(MECANUM_ENCODER_PINS)}};
+
+#undef MECANUM_WHEEL_PINS
+#undef MECANUM_ENCODER_PINS
+
+/**
+ * @class Wheel
+ * @brief Motor driver on fixed pins (init_wheel() in the constructor, idle() in the destructor)
+*/
+template <unsigned int In1, unsigned int In2>
+class Wheel {
+public:
+    static constexpr MotorDriveGPIO pins{In1, In2};
+
+    explicit Wheel(int pi) noexcept : pi_(pi), rc_(init()) {}
+    ~Wheel() {
+        if (rc_ == RC_OK) (void)idle();
+    }
+
+    Wheel(const Wheel&) = delete;
+    Wheel& operator=(const Wheel&) = delete;
+
+    /** @brief RC_OK if the constructor initialized the pins, otherwise its return code */
+    int status() const noexcept { return rc_; }
+
+    int forward(unsigned int duty) noexcept { return write(clamp(duty), 0); }
+    int reverse(unsigned int duty) noexcept { return write(0, clamp(duty)); }
+    int idle() noexcept { return write(0, 0); }
+    /** @brief Emergency brake, see brake() in wheel_control.h */
+    int brake() noexcept { return write(DUTYCYCLE_RANGE, DUTYCYCLE_RANGE); }
+
+    /**
+     * @brief Re-apply pin setup and the last duties on a new daemon connection (see restore_wheel())
+     * @return RC_OK if OK, otherwise RC_INVALID_OPERATION or RC_DAEMON_DISCONNECTED
+    */
+    int restore(int pi) noexcept {
+        pi_ = pi;
+        int rc = setup();
+        if (rc == RC_OK) rc = write(duty_[0], duty_[1]);
+        rc_ = rc;
+        return rc;
+    }
+
+private:
+    static constexpr unsigned int clamp(unsigned int duty) noexcept {
+        return duty > DUTYCYCLE_RANGE ? DUTYCYCLE_RANGE : duty;
+    }
+
+    int write(unsigned int in1Duty, unsigned int in2Duty) noexcept {
+        int rc = set_PWM_dutycycle(pi_, In1, in1Duty);
+        if (likely(rc >= 0)) rc = set_PWM_dutycycle(pi_, In2, in2Duty);
+        if (unlikely(rc < 0)) return pigpiod_error_rc(rc);
+        //kept so that restore() can replay the last command after a reconnect
+        duty_[0] = in1Duty;
+        duty_[1] = in2Duty;
+        return RC_OK;
+    }
+
+    int setup() noexcept {
+        int rc = set_mode(pi_, In1, PI_OUTPUT);
+        if (rc >= 0) rc = set_mode(pi_, In2, PI_OUTPUT);
+        if (rc >= 0) rc = set_PWM_frequency(pi_, In1, FREQUENCY);
+        if (rc >= 0) rc = set_PWM_frequency(pi_, In2, FREQUENCY);
+        if (rc >= 0) rc = set_PWM_range(pi_, In1, DUTYCYCLE_RANGE);
+        if (rc >= 0) rc = set_PWM_range(pi_, In2, DUTYCYCLE_RANGE);
+        return rc >= 0 ? RC_OK : pigpiod_error_rc(rc);
+    }
+
+    int init() noexcept {
+        int rc = setup();
+        return rc == RC_OK ? write(0, 0) : rc;
+    }
+
+    int pi_;
+    unsigned int duty_[NUM_WIRES_PER_WHEEL] = {0, 0};
+    int rc_;
+};
+
+/**
+ * @class Encoder
+ * @brief Encoder on fixed pins with the decoder chosen at compile time
+ *
+ * Callbacks are registered in the constructor and cancelled in the destructor (as deinit_encoder()).
+ * callback_cancel() does not wait for a callback already running on the pigpiod_if2 notify thread,
+ * so the counters are not part of the object: like ENCODERS[], they have static storage (one set per
+ * pin pair and mode), and a late callback after the destructor only updates them. Keep at most one
+ * object per pin pair and mode alive; a new one starts the counters from 0
+*/
+template <unsigned int ChA, unsigned int ChB, EncoderMultiplication Mode>
+class Encoder {
+    static_assert(Mode == X1 || Mode == X2 || Mode == X4, "Encoder supports X1, X2 and X4 (use the C API for XADAPTIVE)");
+
+public:
+    static constexpr EncoderGPIO pins{ChA, ChB};
+
+    explicit Encoder(int pi) noexcept : pi_(pi), rc_(init()) {}
+    ~Encoder() { cancel(); }
+
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    /** @brief RC_OK if the constructor registered the callbacks, otherwise its return code */
+    int status() const noexcept { return rc_; }
+
+    int32_t position() const noexcept { return state_.position; }
+    void set_position(int32_t val) noexcept { state_.position = val; }
+    /** @brief Timestamp of the last counted edge (pigpiod tick) */
+    uint32_t tick() const noexcept { return state_.tick; }
+    static constexpr int multiplier() noexcept { return static_cast<int>(Mode); }
+
+    /**
+     * @brief Re-apply pin setup and re-register the callbacks on a new daemon connection (see restore_encoder())
+     *
+     * The position is kept, the pins are compared with the state at the last counted edge
+     * (see encoder_resync_state())
+     *
+     * @param edgeGap Set to true if edges were lost while disconnected (may be nullptr)
+     * @return RC_OK if OK, otherwise RC_INVALID_OPERATION or RC_DAEMON_DISCONNECTED
+    */
+    int restore(int pi, bool* edgeGap = nullptr) noexcept {
+        if (edgeGap != nullptr) *edgeGap = false;
+        //callback ids are local to pigpiod_if2, so cancel them even though the old socket is gone
+        cancel();
+        pi_ = pi;
+        rc_ = setup();
+        if (rc_ != RC_OK) return rc_;
+
+        int levelA = gpio_read(pi_, ChA);
+        int levelB = gpio_read(pi_, ChB);
+        if (levelA < 0 || levelB < 0) return rc_ = pigpiod_error_rc(levelA < 0 ? levelA : levelB);
+        bool lost = encoder_resync_state(&state_, Mode, levelA, levelB);
+        if (edgeGap != nullptr) *edgeGap = lost;
+        //the daemon may have restarted, so the old tick belongs to another clock
+        state_.tick = get_current_tick(pi_) - MIN_PULSE_US;
+
+        rc_ = register_callbacks();
+        return rc_;
+    }
+
+private:
+    static void on_edge_changed(int pi, unsigned int gpio, unsigned int level, uint32_t tick, void* userdata) {
+        UNUSED_PARAMETER(userdata);
+        EncoderState& st = state_;
+        if (static_cast<uint32_t>(tick - st.tick) < MIN_PULSE_US) return;
+
+        if constexpr (Mode == X1) {
+            int levelB = gpio_read(pi, ChB);
+            st.position += levelB == LOW ? 1 : -1;
+            st.prevState = static_cast<uint8_t>(((HIGH << 1) | levelB) & MASK_LOWER2);
+        }
+        else if constexpr (Mode == X2) {
+            static constexpr int8_t LOOKUP_X2[2][2] = {{-1, 1}, {1, -1}};
+            int levelB = gpio_read(pi, ChB);
+            st.position += LOOKUP_X2[level][levelB];
+            st.prevState = static_cast<uint8_t>(((level << 1) | levelB) & MASK_LOWER2);
+        }
+        else {
+            static constexpr int8_t LOOKUP_X4[4][4] = {
+                {0, -1, 1, 0},
+                {1, 0, 0, -1},
+                {-1, 0, 0, 1},
+                {0, 1, -1, 0}
+            };
+            int levelA = gpio == ChA ? static_cast<int>(level) : gpio_read(pi, ChA);
+            int levelB = gpio == ChA ? gpio_read(pi, ChB) : static_cast<int>(level);
+            int currentState = ((levelA << 1) | levelB) & MASK_LOWER2;
+            st.position += LOOKUP_X4[st.prevState][currentState];
+            st.prevState = static_cast<uint8_t>(currentState);
+        }
+        st.tick = tick;
+    }
+
+    int setup() noexcept {
+        int rc = set_mode(pi_, ChA, PI_INPUT);
+        if (rc >= 0) rc = set_mode(pi_, ChB, PI_INPUT);
+        if (rc >= 0) rc = set_pull_up_down(pi_, ChA, PI_PUD_UP);
+        if (rc >= 0) rc = set_pull_up_down(pi_, ChB, PI_PUD_UP);
+        return rc >= 0 ? RC_OK : pigpiod_error_rc(rc);
+    }
+
+    int init() noexcept {
+        int rc = setup();
+        if (rc != RC_OK) return rc;
+        state_.position = 0;
+        state_.tick = 0;
+        state_.direction = 0;
+        state_.prevState = static_cast<uint8_t>(((gpio_read(pi_, ChA) << 1) | gpio_read(pi_, ChB)) & MASK_LOWER2);
+        return register_callbacks();
+    }
+
+    int register_callbacks() noexcept {
+        callbackIdA_ = callback_ex(pi_, ChA, Mode == X1 ? RISING_EDGE : EITHER_EDGE, on_edge_changed, nullptr);
+        if (callbackIdA_ < 0) return pigpiod_error_rc(callbackIdA_);
+        if constexpr (Mode == X4) {
+            callbackIdB_ = callback_ex(pi_, ChB, EITHER_EDGE, on_edge_changed, nullptr);
+            if (callbackIdB_ < 0) return pigpiod_error_rc(callbackIdB_);
+        }
+        return RC_OK;
+    }
+
+    void cancel() noexcept {
+        if (callbackIdA_ >= 0) (void)callback_cancel(static_cast<unsigned int>(callbackIdA_));
+        if (callbackIdB_ >= 0) (void)callback_cancel(static_cast<unsigned int>(callbackIdB_));
+        callbackIdA_ = -1;
+        callbackIdB_ = -1;
+    }
+
+    static inline EncoderState state_{};  //Hot counters on their own cache line, outlive the object (see above)
+    int pi_;
+    int callbackIdA_ = -1;
+    int callbackIdB_ = -1;
+    int rc_;
+};
+
+/* Wheel and encoder of WHEELS[I] / ENCODERS[I] */
+template <std::size_t I>
+using WheelAt = Wheel<WHEEL_PINS[I].in1, WHEEL_PINS[I].in2>;
+
+template <std::size_t I, EncoderMultiplication Mode>
+using EncoderAt = Encoder<ENCODER_PINS[I].cha, ENCODER_PINS[I].chb, Mode>;
+
+/**
+ * @class Platform
+ * @brief The first N wheels of the pin tables with their encoders
+ *
+ * The table entries must have distinct pins, encoders on the same pins share their counters (see Encoder)
+*/
+template <std::size_t N = ROBOT_MANAGED_WHEEL_COUNT, EncoderMultiplication Mode = X4, typename = std::make_index_sequence<N>>
+class Platform;
+
+template <std::size_t N, EncoderMultiplication Mode, std::size_t... Is>
+class Platform<N, Mode, std::index_sequence<Is...>> {
+    static_assert(N >= 1 && N <= ROBOT_MANAGED_WHEEL_COUNT, "N must be within ROBOT_MANAGED_WHEEL_COUNT");
+
+public:
+    explicit Platform(int pi) noexcept : wheels_(((void)Is, pi)...), encoders_(((void)Is, pi)...) {}
+
+    Platform(const Platform&) = delete;
+    Platform& operator=(const Platform&) = delete;
+
+    /** @brief RC_OK if every wheel and encoder initialized, otherwise the first failure */
+    int status() const noexcept {
+        int rc = RC_OK;
+        ((rc = rc != RC_OK ? rc : std::get<Is>(wheels_).status()), ...);
+        ((rc = rc != RC_OK ? rc : std::get<Is>(encoders_).status()), ...);
+        return rc;
+    }
+
+    template <std::size_t I> WheelAt<I>& wheel() noexcept { return std::get<I>(wheels_); }
+    template <std::size_t I> EncoderAt<I, Mode>& encoder() noexcept { return std::get<I>(encoders_); }
+
+    /**
+     * @brief Drive every wheel, positive duty for forward, negative for reverse, 0 for idle
+     * @return RC_OK if OK, otherwise the first failure
+    */
+    int drive(const std::array<int, N>& duty) noexcept {
+        int rc = RC_OK;
+        ((rc = rc != RC_OK ? rc : drive_one(std::get<Is>(wheels_), duty[Is])), ...);
+        return rc;
+    }
+
+    int idle() noexcept {
+        int rc = RC_OK;
+        ((rc = rc != RC_OK ? rc : std::get<Is>(wheels_).idle()), ...);
+        return rc;
+    }
+
+    std::array<int32_t, N> positions() const noexcept {
+        return {{std::get<Is>(encoders_).position()...}};
+    }
+
+    /**
+     * @brief Restore every wheel and encoder on the handle returned by recover_daemon()
+     *
+     * @param pi New pigpiod handle
+     * @param edgeGapMask bit i is set if encoder i lost edges during the outage (may be nullptr)
+     * @return RC_OK if OK, otherwise the first failure
+    */
+    int restore(int pi, uint32_t* edgeGapMask = nullptr) noexcept {
+        int rc = RC_OK;
+        uint32_t mask = 0;
+        ((rc = rc != RC_OK ? rc : std::get<Is>(wheels_).restore(pi)), ...);
+        ((rc = rc != RC_OK ? rc : restore_one(std::get<Is>(encoders_), pi, Is, mask)), ...);
+        if (edgeGapMask != nullptr) *edgeGapMask = mask;
+        return rc;
+    }
+
+private:
+    template <typename W>
+    static int drive_one(W& wheel, int duty) noexcept {
+        if (duty > 0) return wheel.forward(static_cast<unsigned int>(duty));
+        if (duty < 0) return wheel.reverse(static_cast<unsigned int>(-duty));
+        return wheel.idle();
+    }
+
+    template <typename E>
+    static int restore_one(E& encoder, int pi, std::size_t index, uint32_t& mask) noexcept {
+        bool edgeGap = false;
+        int rc = encoder.restore(pi, &edgeGap);
+        if (edgeGap) mask |= 1U << index;
+        return rc;
+    }
+
+    std::tuple<WheelAt<Is>...> wheels_;
+    std::tuple<EncoderAt<Is, Mode>...> encoders_;
+};
+
+} //namespace mecanum
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_MECANUM_HPP_
@@ -0,0 +1,47 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_RECOVERY_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_RECOVERY_H_
+
+#include "mecanum/wheel_control.h"
+#include "mecanum/encoder.h"
+
+/**
+ * @file recovery.h
+ * @brief Restores the wheel and encoder state after the pigpiod connection is lost
+ *
+ * When a wheel or encoder function returns RC_DAEMON_DISCONNECTED, call recover_daemon()
+ * and continue with the returned handle. Pin modes, PWM setup, last duties and encoder
+ * callbacks are replayed; accumulated encoder positions are kept. Objects of the C++ layer
+ * (mecanum.hpp) are not tracked here, restore them with their restore() member
+*/
+
+/**
+ * @struct RecoveryReport
+ * @brief Result of a recovery
+*/
+typedef struct {
+    uint64_t outage_us;     //Time from recover_daemon() call until the state was replayed
+    unsigned int attempts;  //Number of connection attempts
+    uint32_t edge_gap_mask; //bit i is set if ENCODERS[i] lost edges during the outage
+} RecoveryReport;
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+/**
+ * @brief Reconnect to the pigpiod daemon and replay WHEELS[] and ENCODERS[]
+ *
+ * On failure no handle is left open; RC_DAEMON_DISCONNECTED means the connection dropped again
+ * during the replay and recover_daemon() can be retried (pass -1 as pi)
+ *
+ * @param pi The handle that reported RC_DAEMON_DISCONNECTED (-1 if already closed)
+ * @param report Receives outage duration and edge gaps (may be NULL)
+ * @return >= 0 if OK (new pigpiod handle), otherwise RC_FAIL_DAEMON_CONNECT or RC_DAEMON_DISCONNECTED, RC_INVALID_OPERATION
+*/
+int recover_daemon(int pi, RecoveryReport* report);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_RECOVERY_H_
@@ -0,0 +1,97 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_H_
+
+#include "mecanum/daemon.h"
+
+/**
+ * @file timesync.h
+ * @brief Maps pigpiod ticks (32-bit microseconds, daemon clock) to CLOCK_MONOTONIC nanoseconds
+ *
+ * A background thread samples get_current_tick() against the host clock. Each round keeps the
+ * sample with the shortest round trip, and offset and drift are fitted over the last rounds.
+ * Ticks are extended to 64 bits around the newest sample, so any tick within about 35 minutes
+ * of it (e.g. EncoderInfo.state.tick) can be converted. Failed or frozen ticks (daemon gone)
+ * drop the estimate until the daemon answers again
+*/
+
+/* Constants */
+#define TIME_SYNC_PERIOD_MS 100U       //Default interval between rounds
+#define TIME_SYNC_BURST 8U             //Samples per round, the one with the shortest round trip is kept
+#define TIME_SYNC_WINDOW 32U           //Rounds used for the offset/drift fit
+#define TIME_SYNC_MAX_RTT_US 2000U     //Rounds whose best round trip is longer are dropped
+#define TIME_SYNC_STEP_US 5000U        //Residual treated as a clock step (e.g. daemon restart)
+#define TIME_SYNC_STEP_COUNT 3U        //Consecutive steps before the fit is restarted
+
+/**
+ * @struct TimeSyncStatus
+ * @brief Current state of the estimate
+*/
+typedef struct {
+    int64_t offset_ns;   //Host time minus daemon time at the newest sample
+    double drift_ppm;    //Daemon clock rate error against the host clock
+    uint32_t rtt_us;     //Round trip of the newest accepted sample
+    unsigned int rounds; //Rounds in the current fit
+    bool synced;         //true once at least two rounds have been fitted
+} TimeSyncStatus;
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+/**
+ * @brief Start the synchronization thread
+ *
+ * @param pi pigpiod demon handle
+ * @param periodMs Interval between rounds, 0 for TIME_SYNC_PERIOD_MS
+ * @return RC_OK if OK, otherwise RC_ALREADY_INITIALIZED or RC_INVALID_OPERATION
+*/
+int start_time_sync(int pi, unsigned int periodMs);
+
+/**
+ * @brief Stop the synchronization thread and drop the estimate
+*/
+void stop_time_sync(void);
+
+/**
+ * @brief Drop the estimate and continue on a new handle (e.g. after recover_daemon())
+ *
+ * With a negative handle sampling pauses until the next call with a valid one. Returns once
+ * the thread no longer uses the previous handle. Does nothing if the thread is not running
+ *
+ * @param pi pigpiod demon handle, or -1 to pause
+*/
+void resync_time_sync(int pi);
+
+/**
+ * @brief Extend a 32-bit tick to 64 bits
+ *
+ * @param tick pigpiod tick
+ * @param ext Receives the extended tick in microseconds
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED (not synced yet)
+*/
+int extend_tick(uint32_t tick, int64_t* ext);
+
+/**
+ * @brief Convert a pigpiod tick to CLOCK_MONOTONIC
+ *
+ * Lock-free, safe to call from the control thread and the callback thread
+ *
+ * @param tick pigpiod tick (e.g. ENCODERS[0].state.tick)
+ * @param ns Receives CLOCK_MONOTONIC time in nanoseconds
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED (not synced yet)
+*/
+int tick_to_monotonic_ns(uint32_t tick, int64_t* ns);
+
+/**
+ * @brief Get the current state of the estimate
+ *
+ * @param status Receives the state
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED (not synced yet, status is still filled)
+*/
+int get_time_sync_status(TimeSyncStatus* status);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_H_
@@ -27,6 +27,13 @@
 #define REAR_RIGHT_IN1 GPIO_UNASSIGNED  //13
 #define REAR_RIGHT_IN2 GPIO_UNASSIGNED  //19
 
+/* Wheel table: X(index, in1, in2), one entry per ROBOT_MANAGED_WHEEL_COUNT */
+#define WHEEL_GPIO_TABLE(X) \
+    X(0, FRONT_LEFT_IN1, FRONT_LEFT_IN2) \
+    X(1, FRONT_RIGHT_IN1, FRONT_RIGHT_IN2) \
+    X(2, REAR_LEFT_IN1, REAR_LEFT_IN2) \
+    X(3, REAR_RIGHT_IN1, REAR_RIGHT_IN2)
+
 /**
  * @struct MotorDriveGPIO
  * @brief Holds motor driver output pin numbers
@@ -36,29 +43,16 @@ typedef struct {
     unsigned int in2; //in2
 } MotorDriveGPIO;
 
-#ifdef DEBUG
-/**
- * @struct MotorDriveInfo
- * @brief Motor driver information with debug index 
-*/
-typedef struct {
-    MotorDriveGPIO motordrive; //Motor driver pins
-    bool initialized;          //Initialization status
-    const uint8_t index;       //Wheel index (use debug)
-} MotorDriveInfo;
-
-#else
 /**
  * @struct MotorDriveInfo
- * @brief Motor driver information (release version)
+ * @brief Motor driver information
 */
 typedef struct {
     MotorDriveGPIO motordrive; //Motor driver pins
     bool initialized;          //Initialization status
+    const uint8_t index;       //Wheel index (WHEELS[index]), also selects the duty kept for restore_wheel()
 } MotorDriveInfo;
 
-#endif //DEBUG
-
 #ifdef __cplusplus
 extern "C" {
 #endif //__cplusplus
@@ -80,7 +74,7 @@ int init_wheel(int pi, MotorDriveInfo* target);
  * @param pi pigpiod demon handle
  * @param target Target wheel motor driver (e.g WHEELS[0])
  * @param duty Duty cycle (0 to DUTYCYCLE_RANGE)
- * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
 */
 int forward(int pi, const MotorDriveInfo* target, unsigned int duty);
 
@@ -90,7 +84,7 @@ int forward(int pi, const MotorDriveInfo* target, unsigned int duty);
  * @param pi pigpiod demon handle 
  * @param target Target wheel motor driver (e.g WHEELS[0])
  * @param duty Duty cycle (0 to DUTYCYCLE_RANGE)
- * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
  *
 */
 int reverse(int pi, const MotorDriveInfo* target, unsigned int duty);
@@ -100,7 +94,7 @@ int reverse(int pi, const MotorDriveInfo* target, unsigned int duty);
  *
  * @param pi pigpid demon handle
  * @param target Target wheel motor driver
- * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
 */
 int idle(int pi, const MotorDriveInfo* target);
 
@@ -112,10 +106,21 @@ int idle(int pi, const MotorDriveInfo* target);
  *
  * @param pi pigpid demon handle
  * @param target Target wheel motor driver 
- * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION
+ * @return RC_OK if OK, otherwise RC_UNINITIALIZED or RC_INVALID_OPERATION, RC_DAEMON_DISCONNECTED
 */
 int brake(int pi, const MotorDriveInfo* target);
 
+/**
+ * @brief Re-apply pin modes, PWM frequency/range and the last duty on a new daemon connection
+ *
+ * Does nothing for a wheel that has not been initialized
+ *
+ * @param pi pigpiod demon handle (after reconnect)
+ * @param target Target wheel motor driver
+ * @return RC_OK if OK, otherwise RC_INVALID_OPERATION or RC_DAEMON_DISCONNECTED
+*/
+int restore_wheel(int pi, const MotorDriveInfo* target);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+
+#include "mecanum/calibration.h"
+#include "monotonic.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * File layout (native byte order)
+ *   header : magic u32 | version u16 | wheel count u16 | lut size u16 | reserved u16
+ *   wheel  : calibrated u8 | {max_speed f32 | duty u16 x CALIBRATION_LUT_SIZE} x 2 directions
+ *   footer : FNV-1a u32 of everything before it
+**/
+#define CALIBRATION_HEADER_SIZE 12U
+#define CALIBRATION_TABLE_SIZE (sizeof(float) + sizeof(uint16_t) * CALIBRATION_LUT_SIZE)
+#define CALIBRATION_WHEEL_SIZE (1U + 2U * CALIBRATION_TABLE_SIZE)
+#define CALIBRATION_FILE_SIZE (CALIBRATION_HEADER_SIZE + ROBOT_MANAGED_WHEEL_COUNT * CALIBRATION_WHEEL_SIZE + sizeof(uint32_t))
+
+WheelCalibration CALIBRATIONS[ROBOT_MANAGED_WHEEL_COUNT];
+
+static inline uint32_t fnv1a(const uint8_t* data, size_t len) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static inline void update_scale(SpeedTable* table) {
+    table->scale = table->max_speed > 0.0f ? (float)(CALIBRATION_LUT_SIZE - 1U) / table->max_speed : 0.0f;
+}
+
+//Measures the steady-state speed (pulses/s) at one duty
+static int measure_speed(int pi, const MotorDriveInfo* wheel, const EncoderInfo* encoder, WheelDirection dir, unsigned int duty, float* speed) {
+    int rc = dir == DIRECTION_FORWARD ? forward(pi, wheel, duty) : reverse(pi, wheel, duty);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    sleep_ms(CALIBRATION_SETTLE_MS);
+
+    int32_t p0 = get_position(encoder);
+    int64_t t0 = monotonic_ns();
+    sleep_ms(CALIBRATION_MEASURE_MS);
+    int32_t p1 = get_position(encoder);
+    int64_t t1 = monotonic_ns();
+
+    float pulses = (float)abs(p1 - p0) / (float)get_multiplier(encoder);
+    *speed = pulses * 1e9f / (float)(t1 - t0);
+    return RC_OK;
+}
+
+void build_speed_table(const float speed[CALIBRATION_STEPS + 1U], SpeedTable* table) {
+    assert(speed != NULL);
+    assert(table != NULL);
+
+    float monotone[CALIBRATION_STEPS + 1U];
+    unsigned int deadband = 0;
+
+    //index 0 is duty 0; the curve is made non-decreasing so it can be inverted
+    monotone[0] = 0.0f;
+    for (unsigned int k = 1; k <= CALIBRATION_STEPS; ++k) {
+        monotone[k] = speed[k] > monotone[k - 1] ? speed[k] : monotone[k - 1];
+        if (monotone[k] < CALIBRATION_MIN_SPEED) deadband = k;
+    }
+
+    table->max_speed = monotone[CALIBRATION_STEPS];
+    update_scale(table);
+    if (table->max_speed < CALIBRATION_MIN_SPEED) {
+        (void)memset(table->duty, 0, sizeof(table->duty));
+        return;
+    }
+
+    unsigned int k = deadband + 1U;
+    table->duty[0] = (uint16_t)(deadband * DUTYCYCLE_RANGE / CALIBRATION_STEPS);
+    for (unsigned int i = 1; i < CALIBRATION_LUT_SIZE; ++i) {
+        float target = (float)i * table->max_speed / (float)(CALIBRATION_LUT_SIZE - 1U);
+        while (k < CALIBRATION_STEPS && monotone[k] < target) ++k;
+
+        float lo = monotone[k - 1], hi = monotone[k];
+        float frac = hi > lo ? (target - lo) / (hi - lo) : 1.0f;
+        if (frac < 0.0f) frac = 0.0f;
+        if (frac > 1.0f) frac = 1.0f;
+        float duty = ((float)(k - 1U) + frac) * (float)DUTYCYCLE_RANGE / (float)CALIBRATION_STEPS;
+        table->duty[i] = (uint16_t)(duty + 0.5f);
+    }
+}
+
+int calibrate_wheel(int pi, const MotorDriveInfo* wheel, const EncoderInfo* encoder, WheelCalibration* out) {
+    assert(wheel != NULL);
+    assert(encoder != NULL);
+    assert(out != NULL);
+    assert(pi >= 0);
+
+    if (!wheel->initialized || !encoder->initialized) {
+#ifdef DEBUG
+        debug_log(stderr, "[calibration warning]: Wheel %s and Encoder %s must be initialized before calibration \n", get_wheel_name(wheel->index), get_encoder_name(encoder->index));
+#endif //DEBUG
+        return RC_UNINITIALIZED;
+    }
+
+    WheelCalibration result = {.calibrated = false};
+    for (unsigned int dir = DIRECTION_FORWARD; dir <= DIRECTION_REVERSE; ++dir) {
+        float speed[CALIBRATION_STEPS + 1U];
+        speed[0] = 0.0f;
+        for (unsigned int k = 1; k <= CALIBRATION_STEPS; ++k) {
+            int rc = measure_speed(pi, wheel, encoder, (WheelDirection)dir, k * DUTYCYCLE_RANGE / CALIBRATION_STEPS, &speed[k]);
+            if (rc != RC_OK) {
+                (void)idle(pi, wheel);
+                return rc;
+            }
+        }
+        build_speed_table(speed, &result.table[dir]);
+
+        int rc = idle(pi, wheel);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        sleep_ms(CALIBRATION_SETTLE_MS);
+    }
+
+    result.calibrated = true;
+    *out = result;
+    return RC_OK;
+}
+
+int save_calibration(const char* path) {
+    assert(path != NULL);
+
+    uint8_t buf[CALIBRATION_FILE_SIZE];
+    uint8_t* p = buf;
+    const uint32_t magic = CALIBRATION_FILE_MAGIC;
+    const uint16_t header[4] = {CALIBRATION_FILE_VERSION, ROBOT_MANAGED_WHEEL_COUNT, CALIBRATION_LUT_SIZE, 0};
+
+    (void)memcpy(p, &magic, sizeof(magic)); p += sizeof(magic);
+    (void)memcpy(p, header, sizeof(header)); p += sizeof(header);
+    for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+        *p++ = CALIBRATIONS[i].calibrated ? 1U : 0U;
+        for (unsigned int dir = DIRECTION_FORWARD; dir <= DIRECTION_REVERSE; ++dir) {
+            const SpeedTable* table = &CALIBRATIONS[i].table[dir];
+            (void)memcpy(p, &table->max_speed, sizeof(float)); p += sizeof(float);
+            (void)memcpy(p, table->duty, sizeof(table->duty)); p += sizeof(table->duty);
+        }
+    }
+    uint32_t checksum = fnv1a(buf, (size_t)(p - buf));
+    (void)memcpy(p, &checksum, sizeof(checksum));
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+#ifdef DEBUG
+        debug_log(stderr, "[calibration error]: Failed to open %s \n", path);
+#endif //DEBUG
+        return RC_INVALID_OPERATION;
+    }
+    size_t written = fwrite(buf, 1, sizeof(buf), fp);
+    if (fclose(fp) != 0 || written != sizeof(buf)) {
+        return RC_INVALID_OPERATION;
+    }
+    return RC_OK;
+}
+
+int load_calibration(const char* path) {
+    assert(path != NULL);
+
+    uint8_t buf[CALIBRATION_FILE_SIZE + 1U];
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return RC_INVALID_OPERATION;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), fp);
+    (void)fclose(fp);
+
+    uint32_t magic, checksum;
+    uint16_t header[4];
+    if (len != CALIBRATION_FILE_SIZE) {
+        return RC_INVALID_OPERATION;
+    }
+    (void)memcpy(&magic, buf, sizeof(magic));
+    (void)memcpy(header, buf + sizeof(magic), sizeof(header));
+    (void)memcpy(&checksum, buf + len - sizeof(checksum), sizeof(checksum));
+    if (magic != CALIBRATION_FILE_MAGIC || header[0] != CALIBRATION_FILE_VERSION
+        || header[1] != ROBOT_MANAGED_WHEEL_COUNT || header[2] != CALIBRATION_LUT_SIZE
+        || checksum != fnv1a(buf, len - sizeof(checksum))) {
+#ifdef DEBUG
+        debug_log(stderr, "[calibration error]: %s does not match this build \n", path);
+#endif //DEBUG
+        return RC_INVALID_OPERATION;
+    }
+
+    const uint8_t* p = buf + CALIBRATION_HEADER_SIZE;
+    for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+        CALIBRATIONS[i].calibrated = *p++ != 0U;
+        for (unsigned int dir = DIRECTION_FORWARD; dir <= DIRECTION_REVERSE; ++dir) {
+            SpeedTable* table = &CALIBRATIONS[i].table[dir];
+            (void)memcpy(&table->max_speed, p, sizeof(float)); p += sizeof(float);
+            (void)memcpy(table->duty, p, sizeof(table->duty)); p += sizeof(table->duty);
+            update_scale(table);
+        }
+    }
+    return RC_OK;
+}
+
+int set_wheel_speed(int pi, const MotorDriveInfo* target, const WheelCalibration* cal, float speed) {
+    assert(target != NULL);
+    assert(cal != NULL);
+    assert(pi >= 0);
+
+    if (unlikely(!cal->calibrated)) {
+        return RC_UNINITIALIZED;
+    }
+    if (speed > 0.0f) {
+        return forward(pi, target, feedforward_duty(&cal->table[DIRECTION_FORWARD], speed));
+    }
+    if (speed < 0.0f) {
+        return reverse(pi, target, feedforward_duty(&cal->table[DIRECTION_REVERSE], -speed));
+    }
+    return idle(pi, target);
+}
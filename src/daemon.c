@@ -1,6 +1,43 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep, sigaction
+
 #include "mecanum/daemon.h"
+#include "monotonic.h"
+#include <string.h>
+#include <signal.h>
+
+#define DAEMON_ENDPOINT_LEN 256U
+
+static char daemonAddr[DAEMON_ENDPOINT_LEN];  //empty means LOCALHOST
+static char daemonPort[DAEMON_ENDPOINT_LEN];  //empty means DEFAULT_PORT
+
+static inline void remember_endpoint(char* dst, const char* src) {
+    if (src == NULL) {
+        dst[0] = '\0';
+        return;
+    }
+    (void)strncpy(dst, src, DAEMON_ENDPOINT_LEN - 1U);
+    dst[DAEMON_ENDPOINT_LEN - 1U] = '\0';
+}
+
+static inline const char* endpoint_or_null(const char* endpoint) {
+    return endpoint[0] == '\0' ? NULL : endpoint;
+}
+
+//pigpiod_if2 sends without MSG_NOSIGNAL, so a write to a dropped daemon raises SIGPIPE; a handler set by the application is kept
+static inline void ignore_default_sigpipe(void) {
+    struct sigaction sa;
+    if (sigaction(SIGPIPE, NULL, &sa) != 0 || sa.sa_handler != SIG_DFL) return;
+    sa.sa_handler = SIG_IGN;
+    sa.sa_flags = 0;
+    (void)sigemptyset(&sa.sa_mask);
+    (void)sigaction(SIGPIPE, &sa, NULL);
+}
 
 int pigpiod_daemon_open(const char* addr, const char* port) {
+    remember_endpoint(daemonAddr, addr);
+    remember_endpoint(daemonPort, port);
+    ignore_default_sigpipe();
+
         int pi = pigpio_start(addr, port);
         if (pi >= 0) return pi;
 #ifdef DEBUG
@@ -13,3 +50,26 @@ void pigpiod_daemon_close(int pi) {
     assert(pi >= 0);
     pigpio_stop(pi);
 }
+
+int pigpiod_daemon_reopen(int pi, unsigned int* attempts) {
+    ignore_default_sigpipe();
+    //releases the slot so pigpio_start() hands out the same handle again
+    if (pi >= 0) pigpio_stop(pi);
+
+    unsigned int backoff = RECONNECT_BACKOFF_INITIAL_US;
+    for (unsigned int i = 1; i <= RECONNECT_MAX_ATTEMPTS; ++i) {
+        int newPi = pigpio_start(endpoint_or_null(daemonAddr), endpoint_or_null(daemonPort));
+        if (newPi >= 0) {
+            if (attempts != NULL) *attempts = i;
+            return newPi;
+        }
+        if (i == RECONNECT_MAX_ATTEMPTS) break;
+        sleep_us(backoff);
+        backoff = backoff * 2U > RECONNECT_BACKOFF_MAX_US ? RECONNECT_BACKOFF_MAX_US : backoff * 2U;
+    }
+#ifdef DEBUG
+    debug_log(stderr, "[pigpiod daemon]: Failed to reconnect daemon after %u attempts \n", RECONNECT_MAX_ATTEMPTS);
+#endif //DEBUG
+    if (attempts != NULL) *attempts = RECONNECT_MAX_ATTEMPTS;
+    return RC_FAIL_DAEMON_CONNECT;
+}
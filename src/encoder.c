@@ -1,4 +1,8 @@
-#include "mecanum/encoder.h"
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include "encoder_internal.h"
+#include "monotonic.h"
+#include <stddef.h>
 #include <assert.h>
 
 /**      
@@ -40,21 +44,28 @@
  *
 **/
 
-#ifdef DEBUG
+#define ENCODER_ENTRY(i, a, b) \
+    [i] = {.state = {.position = 0, .tick = 0, .prevState = 0x0, .direction = 0}, .encoder = {.cha = a, .chb = b}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1, .adaptive = false, .initialized = false, .index = i},
+#define ENCODER_COUNT(i, a, b) + 1
+
+_Static_assert(0 ENCODER_GPIO_TABLE(ENCODER_COUNT) == ROBOT_MANAGED_WHEEL_COUNT, "ENCODER_GPIO_TABLE must have ROBOT_MANAGED_WHEEL_COUNT entries");
+
+#if defined(__GNUC__) || defined(__clang__)
+_Static_assert(offsetof(EncoderInfo, encoder) == CACHE_LINE_SIZE && offsetof(EncoderInfo, rate) % CACHE_LINE_SIZE == 0,
+               "hot counters, configuration and rate tracking must sit on separate cache lines");
+#endif
+
 EncoderInfo ENCODERS[ROBOT_MANAGED_WHEEL_COUNT] = {
-    {.encoder = {.cha = ENCODER_FRONT_LEFT_CH_A, .chb = ENCODER_FRONT_LEFT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1,  .prevState = 0x0, .initialized = false, .index = 0},
-    {.encoder = {.cha = ENCODER_FRONT_RIGHT_CH_A, .chb = ENCODER_FRONT_RIGHT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false, .index = 1},
-    {.encoder = {.cha = ENCODER_REAR_LEFT_CH_A, .chb = ENCODER_REAR_LEFT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false, .index = 2},
-    {.encoder = {.cha = ENCODER_REAR_RIGHT_CH_A, .chb = ENCODER_REAR_RIGHT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false, .index = 3}
+    ENCODER_GPIO_TABLE(ENCODER_ENTRY)
 };
-#else
-EncoderInfo ENCODERS[ROBOT_MANAGED_WHEEL_COUNT] = {
-    {.encoder = {.cha = ENCODER_FRONT_LEFT_CH_A, .chb = ENCODER_FRONT_LEFT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false},
-    {.encoder = {.cha = ENCODER_FRONT_RIGHT_CH_A, .chb = ENCODER_FRONT_RIGHT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false},
-    {.encoder = {.cha = ENCODER_REAR_LEFT_CH_A, .chb = ENCODER_REAR_LEFT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false},
-    {.encoder = {.cha = ENCODER_REAR_RIGHT_CH_A, .chb = ENCODER_REAR_RIGHT_CH_B}, .mode = UNSET, .position = 0, .tick = 0, .callback_id_a = -1, .callback_id_b = -1, .prevState = 0x0, .initialized = false}
+
+//Position step for a (previous state, current state) pair, 0 for no change or a skipped state
+static const int8_t LOOKUP_X4[4][4] = {
+    {0, -1, 1, 0},
+    {1, 0, 0, -1},
+    {-1, 0, 0, 1},
+    {0, 1, -1, 0}
 };
-#endif //DEBUG
 
 static void on_edge_changed_x1(int pi, unsigned int gpio, unsigned int level, uint32_t tick, void* userdata) {
     assert(userdata != NULL);
@@ -62,11 +73,13 @@ static void on_edge_changed_x1(int pi, unsigned int gpio, unsigned int level, ui
     EncoderInfo* ei = (EncoderInfo*)userdata;
     
     assert(gpio == ei->encoder.cha);
-    if ((uint32_t)(tick - ei->tick) < MIN_PULSE_US) return;
+    if ((uint32_t)(tick - ei->state.tick) < MIN_PULSE_US) return;
     
     //There is always an interruption when the edge is standing, so just check at B
-    ei->position += gpio_read(pi, ei->encoder.chb) == LOW ? 1 : -1;
-    ei->tick = tick;
+    int levelB = gpio_read(pi, ei->encoder.chb);
+    ei->state.position += levelB == LOW ? 1 : -1;
+    ei->state.prevState = ((HIGH << 1) | levelB) & MASK_LOWER2;
+    ei->state.tick = tick;
 }
 
 static void on_edge_changed_x2(int pi, unsigned int gpio, unsigned int level, uint32_t tick, void* userdata) {
@@ -74,29 +87,23 @@ static void on_edge_changed_x2(int pi, unsigned int gpio, unsigned int level, ui
     EncoderInfo* ei = (EncoderInfo*)userdata;
 
     assert(gpio == ei->encoder.cha);
-    if ((uint32_t)(tick - ei->tick) < MIN_PULSE_US) return;
+    if ((uint32_t)(tick - ei->state.tick) < MIN_PULSE_US) return;
     
     static const int8_t LOOKUP_X2[2][2] = {{-1, 1}, {1, -1}};
         
     int levelA = level;
     int levelB = gpio_read(pi, ei->encoder.chb);
 
-    ei->position += LOOKUP_X2[levelA][levelB];
-    ei->tick = tick;
+    ei->state.position += LOOKUP_X2[levelA][levelB];
+    ei->state.prevState = ((levelA << 1) | levelB) & MASK_LOWER2;
+    ei->state.tick = tick;
 }
 
 static void on_edge_changed_x4(int pi, unsigned int gpio, unsigned int level, uint32_t tick, void* userdata) {
     assert(userdata != NULL);
     EncoderInfo* ei = (EncoderInfo*)userdata;
 
-	if ((uint32_t)(tick - ei->tick) < MIN_PULSE_US) return;
-
-    static const int8_t LOOKUP_X4[4][4] = {
-        {0, -1, 1, 0},
-        {1, 0, 0, -1},
-        {-1, 0, 0, 1},
-        {0, 1, -1, 0}
-    };
+	if ((uint32_t)(tick - ei->state.tick) < MIN_PULSE_US) return;
 
     int levelA, levelB;
 
@@ -110,34 +117,155 @@ static void on_edge_changed_x4(int pi, unsigned int gpio, unsigned int level, ui
     }
 
     int currentState = ((levelA << 1) | levelB) & MASK_LOWER2;
-    int prevState = ei->prevState;
+    int prevState = ei->state.prevState;
     
-    ei->position += LOOKUP_X4[prevState][currentState];
-    ei->prevState = currentState & MASK_LOWER2;
-    ei->tick = tick;
+    ei->state.position += LOOKUP_X4[prevState][currentState];
+    ei->state.prevState = currentState & MASK_LOWER2;
+    ei->state.tick = tick;
 }  
 
+//Position of a state within one cw cycle (00 -> 10 -> 11 -> 01), indexed by state
+static const uint8_t PHASE_X4[4] = {0, 3, 1, 2};
+
+/**
+ * XADAPTIVE: every registration uses this callback and the active mode decides which edges count.
+ * While switching, the old and the new registration may both deliver an edge; both copies carry
+ * the same tick, so the MIN_PULSE_US check drops the second one
+ *
+ * The position is the exact X4 count at the last observed edge. In X2/X1 an A edge adds the
+ * steps from prevState to the current state in the direction of that edge, so the B edges in
+ * between are counted when they are passed, not in advance. When X4 takes over, a B edge that
+ * happened before its callback was registered shows up as a two-state jump on the next edge
+ * and is counted in the last direction
+**/
+static void on_edge_changed_adaptive(int pi, unsigned int gpio, unsigned int level, uint32_t tick, void* userdata) {
+    assert(userdata != NULL);
+    EncoderInfo* ei = (EncoderInfo*)userdata;
+    EncoderMultiplication mode = ei->mode;
+
+    if (mode != X4 && (gpio != ei->encoder.cha || (mode == X1 && level != HIGH))) return;
+    if ((uint32_t)(tick - ei->state.tick) < MIN_PULSE_US) return;
+
+    int levelA, levelB;
+
+    if (gpio == ei->encoder.cha) {
+        levelA = level;
+        levelB = gpio_read(pi, ei->encoder.chb);
+    }
+    else {
+        levelA = gpio_read(pi, ei->encoder.cha);
+        levelB = level;
+    }
+
+    static const int8_t LOOKUP_X2[2][2] = {{-1, 1}, {1, -1}};
+    int currentState = ((levelA << 1) | levelB) & MASK_LOWER2;
+    int prevState = ei->state.prevState;
+    int delta;
+
+    if (mode == X4) {
+        delta = LOOKUP_X4[prevState][currentState];
+        if (delta == 0 && prevState != currentState) delta = 2 * ei->state.direction;
+    }
+    else {
+        int dir = mode == X1 ? (levelB == LOW ? 1 : -1) : LOOKUP_X2[levelA][levelB];
+        int steps = ((PHASE_X4[currentState] - PHASE_X4[prevState]) * dir) & MASK_LOWER2;
+        delta = dir * (steps == 0 ? 4 : steps);
+    }
+
+    ei->state.position += delta;
+    if (delta != 0) ei->state.direction = delta > 0 ? 1 : -1;
+    ei->state.prevState = currentState & MASK_LOWER2;
+    ei->state.tick = tick;
+}
+
+static inline int residency_index(EncoderMultiplication mode) {
+    return mode == X1 ? 0 : mode == X2 ? 1 : 2;
+}
+
 static inline int init_encoder_gpio(int pi, const EncoderInfo* target) {
     unsigned int cha = target->encoder.cha;
     unsigned int chb = target->encoder.chb;   
+    int rc;
 
     //returns 0 if OK, otherwise PI_BAD_GPIO or PI_BAD_MODE, PI_NOT_PREMITED
-    if (set_mode(pi, cha, PI_INPUT) < 0 || set_mode(pi, chb, PI_INPUT) < 0) {
+    if ((rc = set_mode(pi, cha, PI_INPUT)) < 0 || (rc = set_mode(pi, chb, PI_INPUT)) < 0) {
 #ifdef DEBUG
         debug_log(stderr, "[gpio invalid operation error]: Failed to set input on Encoder %s {GPIO (%u, %u)} \n", get_encoder_name(target->index), cha, chb);
 #endif //DEBUG
-       return RC_INVALID_OPERATION;
+       return pigpiod_error_rc(rc);
     } 
     //returns 0 if OK, otherwise PI_BAD_GPIO or PI_BAD_PUD, PI_NOT_PREMITED
-    if (set_pull_up_down(pi, cha, PI_PUD_UP) < 0 || set_pull_up_down(pi, chb, PI_PUD_UP) < 0) {
+    if ((rc = set_pull_up_down(pi, cha, PI_PUD_UP)) < 0 || (rc = set_pull_up_down(pi, chb, PI_PUD_UP)) < 0) {
 #ifdef DEBUG
         debug_log(stderr, "[gpio invalid operation error]: Failed to set pull up on Encoder %s {GPIO (%u, %u)} \n", get_encoder_name(target->index), cha, chb);
 #endif //DEBUG
-       return RC_INVALID_OPERATION; 
+       return pigpiod_error_rc(rc); 
     } 
     return RC_OK;
  } 
  
+static inline int register_callbacks(int pi, EncoderInfo* target, EncoderMultiplication mode) {
+    switch (mode) {
+    case X1:
+        target->callback_id_a = callback_ex(pi, target->encoder.cha, RISING_EDGE, target->adaptive ? on_edge_changed_adaptive : on_edge_changed_x1, target);
+        if (target->callback_id_a < 0) {
+#ifdef DEBUG
+            debug_log(stderr, "[gpio invalid operation error]: Failed to register interrunpt on Encoder %s {GPIO (%u)} \n", get_encoder_name(target->index), target->encoder.cha);
+#endif //DEBUG
+            return pigpiod_error_rc(target->callback_id_a);
+        } 
+        break;
+
+    case X2:
+        target->callback_id_a = callback_ex(pi, target->encoder.cha, EITHER_EDGE, target->adaptive ? on_edge_changed_adaptive : on_edge_changed_x2, target);
+        if (target->callback_id_a < 0) {
+#ifdef DEBUG
+            debug_log(stderr, "[gpio invalid operation error]: Failed to register interrupt on Encoder %s {GPIO (%u)} \n", get_encoder_name(target->index), target->encoder.cha);
+#endif //DEBUG
+            return pigpiod_error_rc(target->callback_id_a);
+        }
+        break;
+
+    case X4:
+        target->callback_id_a = callback_ex(pi, target->encoder.cha, EITHER_EDGE, target->adaptive ? on_edge_changed_adaptive : on_edge_changed_x4, target);
+        target->callback_id_b = callback_ex(pi, target->encoder.chb, EITHER_EDGE, target->adaptive ? on_edge_changed_adaptive : on_edge_changed_x4, target);
+        if (target->callback_id_a < 0 || target->callback_id_b < 0) {
+#ifdef DEBUG
+            debug_log(stderr, "[gpio invalid operation error]: Failed to register interrupt on Encoder %s {GPIO (%u, %u)} \n", get_encoder_name(target->index), target->encoder.cha, target->encoder.chb);
+#endif //DEBUG
+            return pigpiod_error_rc(target->callback_id_a < 0 ? target->callback_id_a : target->callback_id_b);
+        }
+        break;
+
+    default:
+        return RC_UNKNOWN_MODE;
+    }
+    return RC_OK;
+}
+
+static inline void cancel_callbacks(EncoderInfo* target) {
+    switch (target->mode) {
+    case X1:
+        if (target->callback_id_a >= 0)
+            (void)callback_cancel((unsigned int)target->callback_id_a);
+        break;
+    case X2:
+        if (target->callback_id_a >= 0)
+            (void)callback_cancel((unsigned int)target->callback_id_a);
+        break;
+    case X4:
+        if (target->callback_id_a >= 0)
+            (void)callback_cancel((unsigned int)target->callback_id_a);
+        if (target->callback_id_b >= 0) 
+            (void)callback_cancel((unsigned int)target->callback_id_b);
+        break;
+    default:
+        break;
+    }
+    target->callback_id_a = -1;
+    target->callback_id_b = -1;
+}
+
 int init_encoder(int pi, EncoderInfo* target, EncoderMultiplication mode) {
     assert(target != NULL);
     assert(pi >= 0);
@@ -148,50 +276,28 @@ int init_encoder(int pi, EncoderInfo* target, EncoderMultiplication mode) {
 #endif //DEBUG
         return RC_ALREADY_INITIALIZED; 
     }
-    if (init_encoder_gpio(pi, target) != RC_OK) {
-        return RC_INVALID_OPERATION;
+    int rc = init_encoder_gpio(pi, target);
+    if (rc != RC_OK) {
+        return rc;
     } 
 
     int levelA = gpio_read(pi, target->encoder.cha);
     int levelB = gpio_read(pi, target->encoder.chb);
-    target->prevState = ((levelA << 1) | levelB) & MASK_LOWER2;
-
-    switch (mode) {
-        case X1:
-            target->callback_id_a = callback_ex(pi, target->encoder.cha, RISING_EDGE, on_edge_changed_x1, target);
-            if (target->callback_id_a < 0) {
-#ifdef DEBUG
-                debug_log(stderr, "[gpio invalid operation error]: Failed to register interrunpt on Encoder %s {GPIO (%u)} \n", get_encoder_name(target->index), target->encoder.cha);
-#endif //DEBUG
-                return RC_INVALID_OPERATION;
-            } 
-            break;
+    target->state.prevState = ((levelA << 1) | levelB) & MASK_LOWER2;
 
-        case X2:
-            target->callback_id_a = callback_ex(pi, target->encoder.cha, EITHER_EDGE, on_edge_changed_x2, target);
-            if (target->callback_id_a < 0) {
-#ifdef DEBUG
-                debug_log(stderr, "[gpio invalid operation error]: Failed to register interrupt on Encoder %s {GPIO (%u)} \n", get_encoder_name(target->index), target->encoder.cha);
-#endif //DEBUG
-                return RC_INVALID_OPERATION;
-            }
-            break;
-
-        case X4:
-            target->callback_id_a = callback_ex(pi, target->encoder.cha, EITHER_EDGE, on_edge_changed_x4, target);
-            target->callback_id_b = callback_ex(pi, target->encoder.chb, EITHER_EDGE, on_edge_changed_x4, target);
-            if (target->callback_id_a < 0 || target->callback_id_b < 0) {
-#ifdef DEBUG
-                debug_log(stderr, "[gpio invalid operation error]: Failed to register interrupt on Encoder %s {GPIO (%u, %u)} \n", get_encoder_name(target->index), target->encoder.cha, target->encoder.chb);
-#endif //DEBUG
-                return RC_INVALID_OPERATION;
-            }
-            break;
+    //adaptive encoders start at the finest mode
+    target->adaptive = mode == XADAPTIVE;
+    if (target->adaptive) mode = X4;
 
-        default:
-       return RC_UNKNOWN_MODE;
+    rc = register_callbacks(pi, target, mode);
+    if (rc != RC_OK) {
+        target->adaptive = false;
+        return rc;
     }
 
+    if (target->adaptive) {
+        target->rate = (EncoderAdaptive){.position = target->state.position, .time_ns = monotonic_ns(), .residency_ns = {0, 0, 0}};
+    }
     target->mode = mode;
     target->initialized = true;
      return RC_OK;      
@@ -207,47 +313,150 @@ int deinit_encoder(int pi, EncoderInfo* target, bool cleared) {
 #endif //DEBUG
        return RC_UNINITIALIZED;
     }
-    switch (target->mode) {
-    case X1:
-        if (target->callback_id_a >= 0)
-            (void)callback_cancel((unsigned int)target->callback_id_a);
-        break;
-    case X2:
-        if (target->callback_id_a >= 0)
-            (void)callback_cancel((unsigned int)target->callback_id_a);
-        break;
-    case X4:
-        if (target->callback_id_a >= 0)
-            (void)callback_cancel((unsigned int)target->callback_id_a);
-        if (target->callback_id_b >= 0) 
-            (void)callback_cancel((unsigned int)target->callback_id_b);
-        break;
-    default:
-        break;
-    }
+    cancel_callbacks(target);
     target->initialized = false;
+    target->adaptive = false;
     target->mode = UNSET;
-    target->callback_id_a = -1;
-    target->callback_id_b = -1;
 
     if (cleared) {
-        target->position = 0;
-        target->tick = 0;
-        target->prevState = 0;
+        target->state.position = 0;
+        target->state.tick = 0;
+        target->state.prevState = 0;
+        target->state.direction = 0;
     }
     return RC_OK;
 }
 
+int restore_encoder(int pi, EncoderInfo* target, bool* edgeGap) {
+    assert(target != NULL);
+    assert(pi >= 0);
+
+    if (edgeGap != NULL) *edgeGap = false;
+    if (!target->initialized) {
+        return RC_OK;
+    }
+
+    //callback ids are local to pigpiod_if2, so cancel them even though the old socket is gone
+    EncoderMultiplication mode = target->mode;
+    cancel_callbacks(target);
+
+    int rc = init_encoder_gpio(pi, target);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    int levelA = gpio_read(pi, target->encoder.cha);
+    int levelB = gpio_read(pi, target->encoder.chb);
+    if (levelA < 0 || levelB < 0) {
+        return pigpiod_error_rc(levelA < 0 ? levelA : levelB);
+    }
+    bool lost = encoder_resync_state(&target->state, target->adaptive ? X4 : mode, levelA, levelB);
+    if (edgeGap != NULL) *edgeGap = lost;
+    //the daemon may have restarted, so the old tick belongs to another clock
+    target->state.tick = get_current_tick(pi) - MIN_PULSE_US;
+
+    return register_callbacks(pi, target, mode);
+}
+
 int32_t get_position(const EncoderInfo* target) {
     assert(target != NULL);
-    return target->position;
+    return target->state.position;
 }
 
 void set_position(EncoderInfo* target, int32_t val){
     assert(target != NULL);
-    target->position = val;
+    target->state.position = val;
 }
 
 int get_multiplier(const EncoderInfo *target) {
-    return (int)target->mode;
+    return target->adaptive ? (int)X4 : (int)target->mode;
+}
+
+//Registers what the next mode needs before dropping what it does not, so no edge goes uncounted
+static int switch_mode(int pi, EncoderInfo* target, EncoderMultiplication next) {
+    int oldA = target->callback_id_a;
+    int oldB = target->callback_id_b;
+    int newA = oldA;
+    int newB = oldB;
+    bool edgeChanged = (next == X1) != (target->mode == X1);
+
+    if (edgeChanged) {
+        newA = callback_ex(pi, target->encoder.cha, next == X1 ? RISING_EDGE : EITHER_EDGE, on_edge_changed_adaptive, target);
+        if (newA < 0) {
+            return pigpiod_error_rc(newA);
+        }
+    }
+    if (next == X4 && oldB < 0) {
+        newB = callback_ex(pi, target->encoder.chb, EITHER_EDGE, on_edge_changed_adaptive, target);
+        if (newB < 0) {
+            if (edgeChanged) (void)callback_cancel((unsigned int)newA);
+            return pigpiod_error_rc(newB);
+        }
+    }
+
+    target->mode = next;
+
+    if (edgeChanged) {
+        (void)callback_cancel((unsigned int)oldA);
+    }
+    if (next != X4 && oldB >= 0) {
+        (void)callback_cancel((unsigned int)oldB);
+        newB = -1;
+    }
+    target->callback_id_a = newA;
+    target->callback_id_b = newB;
+    return RC_OK;
+}
+
+int update_encoder_mode(int pi, EncoderInfo* target) {
+    return update_encoder_mode_at(pi, target, monotonic_ns());
+}
+
+int update_encoder_mode_at(int pi, EncoderInfo* target, int64_t nowNs) {
+    assert(target != NULL);
+    assert(pi >= 0);
+
+    if (unlikely(!target->initialized)) {
+        return RC_UNINITIALIZED;
+    }
+    if (!target->adaptive) {
+        return RC_OK;
+    }
+
+    int64_t dt = nowNs - target->rate.time_ns;
+    if (dt <= 0) {
+        return RC_OK;
+    }
+    int32_t position = target->state.position;
+    int32_t delta = position - target->rate.position;
+    EncoderMultiplication mode = target->mode;
+
+    //kept in ns, converting every cycle would drop the sub-microsecond remainder each time
+    target->rate.residency_ns[residency_index(mode)] += (uint64_t)dt;
+    target->rate.position = position;
+    target->rate.time_ns = nowNs;
+
+    //position is in X4 units, the callback sees mode / X4 of those edges
+    double edgeRate = (double)abs(delta) * 1e9 / (double)dt * (double)mode / (double)X4;
+
+    EncoderMultiplication next = mode;
+    if (edgeRate > ADAPTIVE_EDGE_RATE_HIGH && mode != X1) {
+        next = mode == X4 ? X2 : X1;
+    }
+    else if (edgeRate * 2.0 < ADAPTIVE_EDGE_RATE_LOW && mode != X4) {
+        next = mode == X1 ? X2 : X4;
+    }
+    if (next == mode) {
+        return RC_OK;
+    }
+    return switch_mode(pi, target, next);
+}
+
+void get_mode_residency(const EncoderInfo* target, uint64_t residencyUs[3]) {
+    assert(target != NULL);
+    assert(residencyUs != NULL);
+
+    for (int i = 0; i < 3; ++i) {
+        residencyUs[i] = target->rate.residency_ns[i] / 1000U;
+    }
 }
@@ -0,0 +1,29 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_ENCODER_INTERNAL_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_ENCODER_INTERNAL_H_
+
+#include "mecanum/encoder.h"
+
+/**
+ * @file encoder_internal.h
+ * @brief Clock-injected entry points of encoder.c (internal header)
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+/**
+ * @brief update_encoder_mode() with the current time given by the caller
+ *
+ * @param pi pigpiod demon handle
+ * @param target Target encoder
+ * @param nowNs CLOCK_MONOTONIC time (ns), update_encoder_mode() passes monotonic_ns()
+ * @return Same as update_encoder_mode()
+*/
+int update_encoder_mode_at(int pi, EncoderInfo* target, int64_t nowNs);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_ENCODER_INTERNAL_H_
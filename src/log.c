@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+
+#include "log_internal.h"
+#include "mecanum/debug.h"
+#include "monotonic.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1U)
+
+_Static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0, "LOG_RING_SIZE must be a power of two");
+_Static_assert(sizeof(LogEvent) == 16, "LogEvent must stay 16 bytes");
+
+/**
+ * Single producer (the owning thread) / single consumer (the logger thread) ring
+ * Rings stay linked for the logger thread and are never freed. When the owning thread exits, the
+ * ring is released and the next thread that logs takes it over, continuing at its head
+**/
+typedef struct LogRing {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head; //Next slot to write (producer)
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail; //Next slot to read (consumer)
+    struct LogRing* next;
+    atomic_bool owned;                          //Held by a running thread
+    LogEvent events[LOG_RING_SIZE];
+} LogRing;
+
+static _Thread_local LogRing* localRing;
+static _Atomic(LogRing*) rings;
+static atomic_uint ringCount;
+static atomic_uint_fast64_t dropped;
+
+static pthread_once_t ringKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t ringKey;
+static bool ringKeyValid;  //Without the key rings are not released on thread exit
+
+static pthread_t loggerThread;
+static atomic_bool running;
+static FILE* loggerFp;
+static LogFormat loggerFormat;
+
+//Thread exit destructor of ringKey
+static void release_ring(void* ring) {
+    atomic_store_explicit(&((LogRing*)ring)->owned, false, memory_order_release);
+}
+
+static void create_ring_key(void) {
+    ringKeyValid = pthread_key_create(&ringKey, release_ring) == 0;
+}
+
+static LogRing* claim_ring(void) {
+    for (LogRing* ring = atomic_load(&rings); ring != NULL; ring = ring->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&ring->owned, memory_order_relaxed)
+            && atomic_compare_exchange_strong(&ring->owned, &expected, true)) {
+            return ring;
+        }
+    }
+
+    LogRing* ring = aligned_alloc(CACHE_LINE_SIZE, sizeof(LogRing));
+    if (ring == NULL) return NULL;
+    atomic_init(&ring->head, 0U);
+    atomic_init(&ring->tail, 0U);
+    atomic_init(&ring->owned, true);
+
+    ring->next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring->next, ring)) {
+    }
+    atomic_fetch_add_explicit(&ringCount, 1U, memory_order_relaxed);
+    return ring;
+}
+
+static LogRing* acquire_ring(void) {
+    if (likely(localRing != NULL)) return localRing;
+
+    (void)pthread_once(&ringKeyOnce, create_ring_key);
+    LogRing* ring = claim_ring();
+    if (ring == NULL) return NULL;
+    if (ringKeyValid) (void)pthread_setspecific(ringKey, ring);
+    localRing = ring;
+    return ring;
+}
+
+unsigned int log_ring_count(void) {
+    return atomic_load_explicit(&ringCount, memory_order_relaxed);
+}
+
+int format_log_event(const LogEvent* ev, char* buf, size_t len) {
+    assert(ev != NULL);
+    assert(buf != NULL);
+
+    unsigned long long sec = (unsigned long long)(ev->time_ns / 1000000000U);
+    unsigned long long usec = (unsigned long long)(ev->time_ns % 1000000000U / 1000U);
+    const char* wheel = get_wheel_name(ev->index);
+
+    switch (ev->event) {
+    case LOG_WHEEL_UNINITIALIZED:
+        return snprintf(buf, len, "[%llu.%06llu] [gpio setup warning]: Wheel %s {GPIO (%u, %u)} has not been initialized yet, please call init_wheel() before this function \n",
+                        sec, usec, wheel, ev->pin_a, ev->pin_b);
+    case LOG_WHEEL_PWM_FAILED:
+        return snprintf(buf, len, "[%llu.%06llu] [gpio invalid operation error]: Failed to write pwm to Wheel %s {GPIO (%u, %u)} (rc = %d) \n",
+                        sec, usec, wheel, ev->pin_a, ev->pin_b, ev->rc);
+    case LOG_EVENT_SUPPRESSED:
+        return snprintf(buf, len, "[%llu.%06llu] [logger]: %d events of id %u suppressed by the rate limit \n",
+                        sec, usec, ev->rc, ev->index);
+    default:
+        return snprintf(buf, len, "[%llu.%06llu] [logger]: Unknown event %u (index %u, GPIO (%u, %u), rc = %d) \n",
+                        sec, usec, ev->event, ev->index, ev->pin_a, ev->pin_b, ev->rc);
+    }
+}
+
+static void write_event(const LogEvent* ev) {
+    if (loggerFormat == LOG_FORMAT_BINARY) {
+        (void)fwrite(ev, sizeof(*ev), 1, loggerFp);
+        return;
+    }
+    char line[256];
+    (void)format_log_event(ev, line, sizeof(line));
+    (void)fputs(line, loggerFp);
+}
+
+void log_event(LogEventId event, uint8_t index, unsigned int pinA, unsigned int pinB, int rc) {
+    LogEvent ev = {.time_ns = (uint64_t)monotonic_ns(), .rc = rc, .event = (uint8_t)event, .index = index, .pin_a = (uint8_t)pinA, .pin_b = (uint8_t)pinB};
+
+    if (unlikely(!atomic_load_explicit(&running, memory_order_acquire))) {
+        char line[256];
+        (void)format_log_event(&ev, line, sizeof(line));
+        debug_log(stderr, "%s", line);
+        return;
+    }
+
+    LogRing* ring = acquire_ring();
+    if (unlikely(ring == NULL)) {
+        atomic_fetch_add_explicit(&dropped, 1U, memory_order_relaxed);
+        return;
+    }
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (unlikely(head - tail >= LOG_RING_SIZE)) {
+        atomic_fetch_add_explicit(&dropped, 1U, memory_order_relaxed);
+        return;
+    }
+    ring->events[head & LOG_RING_MASK] = ev;
+    atomic_store_explicit(&ring->head, head + 1U, memory_order_release);
+}
+
+uint64_t get_log_dropped(void) {
+    return (uint64_t)atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+void rate_limit_flush(RateLimit* limit, uint64_t now) {
+    for (unsigned int id = 0; id < LOG_EVENT_COUNT; ++id) {
+        if (limit->suppressed[id] != 0U) {
+            LogEvent ev = {.time_ns = now, .rc = (int32_t)limit->suppressed[id], .event = LOG_EVENT_SUPPRESSED, .index = (uint8_t)id, .pin_a = 0, .pin_b = 0};
+            limit->write(&ev);
+        }
+        limit->written[id] = 0;
+        limit->suppressed[id] = 0;
+    }
+}
+
+void rate_limit_consume(RateLimit* limit, const LogEvent* ev) {
+    //Rings are drained one after another, so an older event can follow a newer one: the window only moves forward
+    uint64_t window = ev->time_ns / 1000000000U;
+    if (window > limit->window) {
+        rate_limit_flush(limit, ev->time_ns);
+        limit->window = window;
+    }
+    unsigned int id = ev->event < LOG_EVENT_COUNT ? ev->event : 0U;
+    if (limit->written[id] >= LOG_RATE_LIMIT) {
+        ++limit->suppressed[id];
+        return;
+    }
+    ++limit->written[id];
+    limit->write(ev);
+}
+
+static unsigned int drain_rings(RateLimit* limit) {
+    unsigned int count = 0;
+    for (LogRing* ring = atomic_load(&rings); ring != NULL; ring = ring->next) {
+        unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; ++tail, ++count) {
+            rate_limit_consume(limit, &ring->events[tail & LOG_RING_MASK]);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return count;
+}
+
+static void* logger_main(void* arg) {
+    UNUSED_PARAMETER(arg);
+    RateLimit limit = {.window = 0, .write = write_event};
+
+    while (atomic_load(&running)) {
+        if (drain_rings(&limit) != 0U) {
+            (void)fflush(loggerFp);
+        }
+        else {
+            sleep_ms(LOG_POLL_INTERVAL_MS);
+        }
+    }
+    (void)drain_rings(&limit);
+    rate_limit_flush(&limit, (uint64_t)monotonic_ns());
+    (void)fflush(loggerFp);
+    return NULL;
+}
+
+int start_logger(FILE* fp, LogFormat format) {
+    assert(fp != NULL);
+
+    if (atomic_load(&running)) {
+        return RC_ALREADY_INITIALIZED;
+    }
+    loggerFp = fp;
+    loggerFormat = format;
+    if (format == LOG_FORMAT_BINARY) {
+        LogFileHeader header = {.magic = LOG_FILE_MAGIC, .version = LOG_FILE_VERSION, .record_size = sizeof(LogEvent)};
+        if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+            return RC_INVALID_OPERATION;
+        }
+    }
+
+    atomic_store(&running, true);
+    if (pthread_create(&loggerThread, NULL, logger_main, NULL) != 0) {
+        atomic_store(&running, false);
+        return RC_INVALID_OPERATION;
+    }
+    return RC_OK;
+}
+
+void stop_logger(void) {
+    if (!atomic_exchange(&running, false)) return;
+    (void)pthread_join(loggerThread, NULL);
+}
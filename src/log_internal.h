@@ -0,0 +1,46 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_LOG_INTERNAL_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_LOG_INTERNAL_H_
+
+#include "mecanum/log.h"
+
+/**
+ * @file log_internal.h
+ * @brief Rate limiter and ring bookkeeping of log.c (internal header)
+*/
+
+typedef void (*LogWriter)(const LogEvent* ev);
+
+/**
+ * Per event id limit over one-second windows of LogEvent.time_ns
+*/
+typedef struct {
+    uint64_t window;                        //Current one-second window
+    uint32_t written[LOG_EVENT_COUNT];      //Events written in the window
+    uint32_t suppressed[LOG_EVENT_COUNT];   //Events dropped by the rate limit in the window
+    LogWriter write;                        //Receives the events that pass and the summaries
+} RateLimit;
+
+/**
+ * @brief Write a LOG_EVENT_SUPPRESSED summary per event id that was limited and start counting again
+ *
+ * @param limit Rate limit
+ * @param now Timestamp of the summaries
+*/
+void rate_limit_flush(RateLimit* limit, uint64_t now);
+
+/**
+ * @brief Write an event unless its id has used up LOG_RATE_LIMIT in the current window
+ *
+ * The window only moves forward, an event older than the window counts against it
+ *
+ * @param limit Rate limit
+ * @param ev Event
+*/
+void rate_limit_consume(RateLimit* limit, const LogEvent* ev);
+
+/**
+ * @brief Number of rings allocated so far (rings of exited threads are reused)
+*/
+unsigned int log_ring_count(void);
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_LOG_INTERNAL_H_
@@ -0,0 +1,37 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_MONOTONIC_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_MONOTONIC_H_
+
+#include "mecanum/config.h"
+
+/**
+ * @file monotonic.h
+ * @brief CLOCK_MONOTONIC and sleep helpers shared by the library sources (internal header)
+ *
+ * The including source defines _POSIX_C_SOURCE before its first include
+*/
+
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 199309L
+  #error "define _POSIX_C_SOURCE 200809L before the first include (clock_gettime, nanosleep)"
+#endif //_POSIX_C_SOURCE
+
+static inline int64_t monotonic_ns(void) {
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static inline uint64_t monotonic_us(void) {
+    return (uint64_t)monotonic_ns() / 1000U;
+}
+
+static inline void sleep_us(unsigned int us) {
+    struct timespec ts = {.tv_sec = us / 1000000U, .tv_nsec = (long)(us % 1000000U) * 1000L};
+    (void)nanosleep(&ts, NULL);
+}
+
+static inline void sleep_ms(unsigned int ms) {
+    struct timespec ts = {.tv_sec = ms / 1000U, .tv_nsec = (long)(ms % 1000U) * 1000000L};
+    (void)nanosleep(&ts, NULL);
+}
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_MONOTONIC_H_
@@ -0,0 +1,51 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+
+#include "mecanum/recovery.h"
+#include "mecanum/timesync.h"
+#include "monotonic.h"
+
+int recover_daemon(int pi, RecoveryReport* report) {
+    uint64_t start = monotonic_us();
+    unsigned int attempts = 0;
+    uint32_t gapMask = 0;
+
+    //keep the sync thread off the handle that is about to be stopped
+    resync_time_sync(-1);
+
+    int newPi = pigpiod_daemon_reopen(pi, &attempts);
+    if (newPi < 0) {
+        if (report != NULL) {
+            report->outage_us = monotonic_us() - start;
+            report->attempts = attempts;
+            report->edge_gap_mask = 0;
+        }
+        return RC_FAIL_DAEMON_CONNECT;
+    }
+
+    int rc = RC_OK;
+    for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT && rc == RC_OK; ++i) {
+        rc = restore_wheel(newPi, &WHEELS[i]);
+    }
+    for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT && rc == RC_OK; ++i) {
+        bool edgeGap = false;
+        rc = restore_encoder(newPi, &ENCODERS[i], &edgeGap);
+        if (edgeGap) gapMask |= 1U << i;
+    }
+
+    if (report != NULL) {
+        report->outage_us = monotonic_us() - start;
+        report->attempts = attempts;
+        report->edge_gap_mask = gapMask;
+    }
+    if (rc != RC_OK) {
+#ifdef DEBUG
+        debug_log(stderr, "[pigpiod daemon]: Reconnected but failed to replay the gpio state (rc = %d) \n", rc);
+#endif //DEBUG
+        //no half-replayed handle is handed out; the state is replayed in full by the next call
+        pigpio_stop(newPi);
+        return rc == RC_DAEMON_DISCONNECTED ? RC_DAEMON_DISCONNECTED : RC_INVALID_OPERATION;
+    }
+    //a restarted daemon starts a new tick domain
+    resync_time_sync(newPi);
+    return newPi;
+}
@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+
+#include "timesync_internal.h"
+#include "monotonic.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+//Published model, guarded by a sequence counter: odd while the sync thread is writing
+static SyncModel model;
+static atomic_uint modelSeq;
+static atomic_bool modelValid;
+
+static pthread_t syncThread;
+static pthread_mutex_t sampleLock = PTHREAD_MUTEX_INITIALIZER; //Held while the thread talks to syncPi
+static atomic_bool running;
+static atomic_bool resetRequested;
+static atomic_int syncPi;  //-1 while paused
+static unsigned int syncPeriodMs;
+
+static void publish_model(const SyncModel* m) {
+    unsigned int seq = atomic_load_explicit(&modelSeq, memory_order_relaxed);
+    atomic_store_explicit(&modelSeq, seq + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    model = *m;
+    atomic_store_explicit(&modelSeq, seq + 2U, memory_order_release);
+    atomic_store_explicit(&modelValid, true, memory_order_release);
+}
+
+static bool read_model(SyncModel* m) {
+    if (!atomic_load_explicit(&modelValid, memory_order_acquire)) return false;
+
+    unsigned int before, after;
+    do {
+        before = atomic_load_explicit(&modelSeq, memory_order_acquire);
+        *m = model;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&modelSeq, memory_order_relaxed);
+    } while ((before & 1U) != 0 || before != after);
+    return true;
+}
+
+//Least squares fit of hostNs over ext, centered to keep the doubles precise
+static void fit_model(const SyncPoint* window, unsigned int count, const SyncPoint* newest, uint32_t tick, uint32_t rtt, SyncModel* m) {
+    double meanExt = 0.0, meanHost = 0.0;
+    for (unsigned int i = 0; i < count; ++i) {
+        meanExt += (double)(window[i].ext - newest->ext);
+        meanHost += (double)(window[i].hostNs - newest->hostNs);
+    }
+    meanExt /= count;
+    meanHost /= count;
+
+    double sxy = 0.0, sxx = 0.0;
+    for (unsigned int i = 0; i < count; ++i) {
+        double dx = (double)(window[i].ext - newest->ext) - meanExt;
+        double dy = (double)(window[i].hostNs - newest->hostNs) - meanHost;
+        sxy += dx * dy;
+        sxx += dx * dx;
+    }
+
+    m->nsPerUs = sxx > 0.0 ? sxy / sxx : 1000.0;
+    m->refTick = tick;
+    m->refExt = newest->ext;
+    m->refHostNs = newest->hostNs + (int64_t)(meanHost - m->nsPerUs * meanExt);
+    m->rttUs = rtt;
+    m->rounds = count;
+}
+
+void sync_filter_reset(SyncFilter* f) {
+    f->count = f->head = f->steps = 0;
+    f->haveExt = false;
+}
+
+SyncResult sync_filter_add(SyncFilter* f, uint32_t tick, int64_t hostNs, int64_t rttNs) {
+    //a failed or frozen tick means the daemon is gone, readers must not keep converting with the old fit
+    if (is_tick_error(tick) || (f->haveExt && tick == f->lastTick)) {
+        sync_filter_reset(f);
+        return SYNC_LOST;
+    }
+    if (rttNs > (int64_t)TIME_SYNC_MAX_RTT_US * 1000) {
+        return SYNC_DROPPED;
+    }
+
+    SyncResult result = SYNC_ACCEPTED;
+    SyncPoint point = {.ext = f->haveExt ? f->lastExt + (int32_t)(tick - f->lastTick) : (int64_t)tick, .hostNs = hostNs};
+
+    if (f->count >= 2U) {
+        int64_t residual = hostNs - model_host_ns(&f->model, point.ext);
+        if (llabs(residual) > (long long)TIME_SYNC_STEP_US * 1000) {
+            //an isolated outlier is dropped, a persistent one means the daemon clock moved
+            if (++f->steps < TIME_SYNC_STEP_COUNT) {
+                return SYNC_DROPPED;
+            }
+            f->count = f->head = 0;
+            result = SYNC_RESTARTED;
+        }
+    }
+    f->steps = 0;
+    f->haveExt = true;
+    f->lastTick = tick;
+    f->lastExt = point.ext;
+
+    f->window[f->head] = point;
+    f->head = (f->head + 1U) % TIME_SYNC_WINDOW;
+    if (f->count < TIME_SYNC_WINDOW) ++f->count;
+
+    fit_model(f->window, f->count, &point, tick, (uint32_t)(rttNs / 1000), &f->model);
+    return result;
+}
+
+//Round-trip filtering: keeps the sample with the shortest request/response time, or the first error
+static void sample_round(int pi, int64_t* bestRtt, int64_t* bestMid, uint32_t* bestTick) {
+    *bestRtt = INT64_MAX;
+    for (unsigned int i = 0; i < TIME_SYNC_BURST; ++i) {
+        int64_t t0 = monotonic_ns();
+        uint32_t tick = get_current_tick(pi);
+        int64_t t1 = monotonic_ns();
+        if (is_tick_error(tick)) {
+            *bestTick = tick;
+            return;
+        }
+        if (t1 - t0 < *bestRtt) {
+            *bestRtt = t1 - t0;
+            *bestMid = t0 + (t1 - t0) / 2;
+            *bestTick = tick;
+        }
+    }
+}
+
+static void* sync_main(void* arg) {
+    UNUSED_PARAMETER(arg);
+
+    SyncFilter filter;
+    sync_filter_reset(&filter);
+
+    while (atomic_load(&running)) {
+        if (atomic_exchange(&resetRequested, false)) {
+            sync_filter_reset(&filter);
+            atomic_store_explicit(&modelValid, false, memory_order_release);
+        }
+        int64_t bestRtt = 0, bestMid = 0;
+        uint32_t bestTick = (uint32_t)pigif_unconnected_pi;
+        (void)pthread_mutex_lock(&sampleLock);
+        int pi = atomic_load(&syncPi);
+        if (pi >= 0) sample_round(pi, &bestRtt, &bestMid, &bestTick);
+        (void)pthread_mutex_unlock(&sampleLock);
+
+        SyncResult result = sync_filter_add(&filter, bestTick, bestMid, bestRtt);
+        if (result == SYNC_LOST || result == SYNC_RESTARTED) {
+            atomic_store_explicit(&modelValid, false, memory_order_release);
+        }
+        if (result != SYNC_DROPPED && result != SYNC_LOST && filter.count >= 2U) {
+            publish_model(&filter.model);
+        }
+        sleep_ms(syncPeriodMs);
+    }
+    return NULL;
+}
+
+int start_time_sync(int pi, unsigned int periodMs) {
+    assert(pi >= 0);
+
+    if (atomic_load(&running)) {
+#ifdef DEBUG
+        debug_log(stdout, "[time sync warning]: Time synchronization is already running \n");
+#endif //DEBUG
+        return RC_ALREADY_INITIALIZED;
+    }
+
+    syncPeriodMs = periodMs == 0U ? TIME_SYNC_PERIOD_MS : periodMs;
+    atomic_store(&syncPi, pi);
+    atomic_store(&resetRequested, false);
+    atomic_store(&modelValid, false);
+    atomic_store(&running, true);
+
+    if (pthread_create(&syncThread, NULL, sync_main, NULL) != 0) {
+        atomic_store(&running, false);
+#ifdef DEBUG
+        debug_log(stderr, "[time sync error]: Failed to start time synchronization thread \n");
+#endif //DEBUG
+        return RC_INVALID_OPERATION;
+    }
+    return RC_OK;
+}
+
+void stop_time_sync(void) {
+    if (!atomic_exchange(&running, false)) return;
+    (void)pthread_join(syncThread, NULL);
+    atomic_store(&modelValid, false);
+}
+
+void resync_time_sync(int pi) {
+    if (!atomic_load(&running)) return;
+
+    //waits for a round in progress, so the old handle is no longer used once this returns
+    (void)pthread_mutex_lock(&sampleLock);
+    atomic_store(&syncPi, pi < 0 ? -1 : pi);
+    atomic_store(&resetRequested, true);
+    atomic_store_explicit(&modelValid, false, memory_order_release);
+    (void)pthread_mutex_unlock(&sampleLock);
+}
+
+int extend_tick(uint32_t tick, int64_t* ext) {
+    assert(ext != NULL);
+
+    SyncModel m;
+    if (!read_model(&m)) return RC_UNINITIALIZED;
+    *ext = model_ext(&m, tick);
+    return RC_OK;
+}
+
+int tick_to_monotonic_ns(uint32_t tick, int64_t* ns) {
+    assert(ns != NULL);
+
+    SyncModel m;
+    if (!read_model(&m)) return RC_UNINITIALIZED;
+    *ns = model_host_ns(&m, model_ext(&m, tick));
+    return RC_OK;
+}
+
+int get_time_sync_status(TimeSyncStatus* status) {
+    assert(status != NULL);
+
+    SyncModel m;
+    if (!read_model(&m)) {
+        *status = (TimeSyncStatus){.offset_ns = 0, .drift_ppm = 0.0, .rtt_us = 0, .rounds = 0, .synced = false};
+        return RC_UNINITIALIZED;
+    }
+    status->offset_ns = m.refHostNs - m.refExt * 1000;
+    status->drift_ppm = (m.nsPerUs / 1000.0 - 1.0) * 1e6;
+    status->rtt_us = m.rttUs;
+    status->rounds = m.rounds;
+    status->synced = true;
+    return RC_OK;
+}
@@ -0,0 +1,86 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_INTERNAL_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_INTERNAL_H_
+
+#include "mecanum/timesync.h"
+
+/**
+ * @file timesync_internal.h
+ * @brief Offset/drift filter behind timesync.c (internal header)
+ *
+ * The filter only sees (tick, host time, round trip) samples, so it can be driven with synthetic
+ * samples; the sync thread feeds it from get_current_tick() and publishes its model
+*/
+
+/**
+ * Model published to the readers (host = refHostNs + (ext - refExt) * nsPerUs)
+*/
+typedef struct {
+    uint32_t refTick;    //32-bit tick of the newest sample
+    int64_t refExt;      //Extended value of refTick (us)
+    int64_t refHostNs;   //Fitted host time at refExt
+    double nsPerUs;      //Fitted rate (1000 for equal clocks)
+    uint32_t rttUs;      //Round trip of the newest sample
+    unsigned int rounds; //Rounds in the fit
+} SyncModel;
+
+typedef struct {
+    int64_t ext;    //Extended tick (us)
+    int64_t hostNs; //Host time at the middle of the round trip
+} SyncPoint;
+
+/**
+ * Rounds of the current fit and the tick extension state
+*/
+typedef struct {
+    SyncPoint window[TIME_SYNC_WINDOW];
+    unsigned int count;  //Rounds in the window
+    unsigned int head;   //Next slot of the window
+    unsigned int steps;  //Consecutive residuals above TIME_SYNC_STEP_US
+    bool haveExt;        //lastTick/lastExt are valid
+    uint32_t lastTick;   //Tick of the newest accepted round
+    int64_t lastExt;     //Extended value of lastTick (us)
+    SyncModel model;     //Fit over the window, valid once count >= 2
+} SyncFilter;
+
+/**
+ * @enum SyncResult
+ * @brief Outcome of sync_filter_add()
+ *
+ * -SYNC_ACCEPTED: the round is in the fit
+ * -SYNC_DROPPED: round trip too long or an isolated outlier, the fit is unchanged
+ * -SYNC_RESTARTED: the daemon clock stepped, the fit restarts from this round
+ * -SYNC_LOST: error or frozen tick (daemon gone), the filter is reset
+*/
+typedef enum {SYNC_ACCEPTED = 0, SYNC_DROPPED, SYNC_RESTARTED, SYNC_LOST} SyncResult;
+
+static inline int64_t model_ext(const SyncModel* m, uint32_t tick) {
+    return m->refExt + (int32_t)(tick - m->refTick);
+}
+
+static inline int64_t model_host_ns(const SyncModel* m, int64_t ext) {
+    return m->refHostNs + (int64_t)((double)(ext - m->refExt) * m->nsPerUs);
+}
+
+//get_current_tick() returns the pigif_* error codes cast to uint32_t when the socket is down
+static inline bool is_tick_error(uint32_t tick) {
+    int32_t rc = (int32_t)tick;
+    return rc <= pigif_bad_send && rc > pigif_bad_send - 100;
+}
+
+/**
+ * @brief Drop every round and the tick extension
+*/
+void sync_filter_reset(SyncFilter* f);
+
+/**
+ * @brief Feed the best sample of one round
+ *
+ * @param f Filter
+ * @param tick Daemon tick of the sample (an error code cast to uint32_t is rejected)
+ * @param hostNs Host time at the middle of the round trip
+ * @param rttNs Round trip of the sample
+ * @return SyncResult, f->model is usable after SYNC_ACCEPTED or SYNC_RESTARTED once f->count >= 2
+*/
+SyncResult sync_filter_add(SyncFilter* f, uint32_t tick, int64_t hostNs, int64_t rttNs);
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_TIMESYNC_INTERNAL_H_
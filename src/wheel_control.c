@@ -1,20 +1,18 @@
 #include "mecanum/wheel_control.h"
+#include "mecanum/log.h"
+
+#define WHEEL_ENTRY(i, a, b) \
+    [i] = {.motordrive = {.in1 = a, .in2 = b}, .initialized = false, .index = i},
+#define WHEEL_COUNT(i, a, b) + 1
+
+_Static_assert(0 WHEEL_GPIO_TABLE(WHEEL_COUNT) == ROBOT_MANAGED_WHEEL_COUNT, "WHEEL_GPIO_TABLE must have ROBOT_MANAGED_WHEEL_COUNT entries");
 
-#ifdef DEBUG 
-MotorDriveInfo WHEELS[ROBOT_MANAGED_WHEEL_COUNT] = {
-    {.motordrive = {.in1 = FRONT_LEFT_IN1, .in2 = FRONT_LEFT_IN2}, .initialized = false, .index = 0},
-    {.motordrive = {.in1 = FRONT_RIGHT_IN1, .in2 = FRONT_RIGHT_IN2}, .initialized = false, .index = 1},
-    {.motordrive = {.in1 = REAR_LEFT_IN1, .in2 = REAR_LEFT_IN2}, .initialized = false, .index = 2},
-    {.motordrive = {.in1 = REAR_RIGHT_IN1, .in2 = REAR_RIGHT_IN2}, .initialized = false, .index = 3}
-};
-#else
 MotorDriveInfo WHEELS[ROBOT_MANAGED_WHEEL_COUNT] = {
-    {.motordrive = {.in1 = FRONT_LEFT_IN1, .in2 = FRONT_LEFT_IN2}, .initialized = false},
-    {.motordrive = {.in1 = FRONT_RIGHT_IN1, .in2 = FRONT_RIGHT_IN2}, .initialized = false},
-    {.motordrive = {.in1 = REAR_LEFT_IN1, .in2 = REAR_LEFT_IN2}, .initialized = false},
-    {.motordrive = {.in1 = REAR_RIGHT_IN1, .in2 = REAR_RIGHT_IN2}, .initialized = false}
+    WHEEL_GPIO_TABLE(WHEEL_ENTRY)
 };
-#endif //DEBUG
+
+//Last written duty of in1, in2 per wheel index, replayed by restore_wheel() after a reconnect
+static unsigned int lastDuty[ROBOT_MANAGED_WHEEL_COUNT][NUM_WIRES_PER_WHEEL];
 
 static inline unsigned int clamp_upper(unsigned int value, unsigned int upper) {
     return value > upper ? upper : value;
@@ -23,8 +21,7 @@ static inline unsigned int clamp_upper(unsigned int value, unsigned int upper) {
 static inline int check_init(const MotorDriveInfo* target) {
     if (!target->initialized) {
 #ifdef DEBUG
-        debug_log(stdout, "[gpio setup warning]: Wheel %s {GPIO (%u, %u)} has not been initialized yet, please call init_wheel() before this function", 
-                get_wheel_name(target->index), target->motordrive.in1, target->motordrive.in2);
+        log_event(LOG_WHEEL_UNINITIALIZED, target->index, target->motordrive.in1, target->motordrive.in2, RC_UNINITIALIZED);
 #endif //DEBUG
        return RC_UNINITIALIZED;
 
@@ -33,41 +30,49 @@ static inline int check_init(const MotorDriveInfo* target) {
 }
 
 static inline int init_wheel_gpio(int pi, const MotorDriveInfo* target) {
+    int rc;
    //returns 0 if OK, otherwise PI_BAD_GPIO or PI_BAD_MODE, PI_NOT_PERMITED
-    if (set_mode(pi, target->motordrive.in1, PI_OUTPUT) < 0 || set_mode(pi, target->motordrive.in2, PI_OUTPUT) < 0) {
+    if ((rc = set_mode(pi, target->motordrive.in1, PI_OUTPUT)) < 0 || (rc = set_mode(pi, target->motordrive.in2, PI_OUTPUT)) < 0) {
 #ifdef DEBUG
         debug_log(stderr, "[gpio invalid operation error]: Failed to set output on Wheel %s {GPIO (%u, %u)} \n", get_wheel_name(target->index), target->motordrive.in1, target->motordrive.in2);
 #endif //DEBUG
-       return RC_INVALID_OPERATION;
+       return pigpiod_error_rc(rc);
     }
     return RC_OK;
 }
 
 static inline int init_wheel_pwm(int pi, const MotorDriveInfo* target) {
+    int rc;
     //returns the numerically closest frequency if OK, otherwise PI_BAD_USER_GPIO or PI_NOT_PERMITED
-    if (set_PWM_frequency(pi, target->motordrive.in1, FREQUENCY) < 0 || set_PWM_frequency(pi, target->motordrive.in2, FREQUENCY) < 0) {
+    if ((rc = set_PWM_frequency(pi, target->motordrive.in1, FREQUENCY)) < 0 || (rc = set_PWM_frequency(pi, target->motordrive.in2, FREQUENCY)) < 0) {
 #ifdef DEBUG
         debug_log(stderr, "[gpio invalid operation error]: Failed to set freq %u on Wheel %s {GPIO (%u, %u)} \n", FREQUENCY, get_wheel_name(target->index), target->motordrive.in1, target->motordrive.in2);
 #endif //DEBUG
-       return RC_INVALID_OPERATION;
+       return pigpiod_error_rc(rc);
     }
     //returns the real range for the given GPIO's frequency if OK, otherwise PI_BAD_USER_GPIO or PI_BAD_DUTYCYCLE, PI_NOT_PERMITED
-    if (set_PWM_range(pi, target->motordrive.in1, DUTYCYCLE_RANGE) < 0 || set_PWM_range(pi, target->motordrive.in2, DUTYCYCLE_RANGE) < 0) { 
+    if ((rc = set_PWM_range(pi, target->motordrive.in1, DUTYCYCLE_RANGE)) < 0 || (rc = set_PWM_range(pi, target->motordrive.in2, DUTYCYCLE_RANGE)) < 0) { 
 #ifdef DEBUG
         debug_log(stderr, "[gpio invalid operation error]: Failed to set range %u on Wheel %s {GPIO (%u, %u)}", DUTYCYCLE_RANGE, get_wheel_name(target->index), target->motordrive.in1, target->motordrive.in2);
 #endif //DEBUG
-       return RC_INVALID_OPERATION;
+       return pigpiod_error_rc(rc);
     }
     return RC_OK;
 }
 
-static inline int write_pwm(int pi, const MotorDriveGPIO* motordrive, unsigned int in1Duty, unsigned int in2Duty) {
-    if (set_PWM_dutycycle(pi, motordrive->in1, in1Duty) < 0 || set_PWM_dutycycle(pi, motordrive->in2, in2Duty) < 0) {
+static inline int write_pwm(int pi, const MotorDriveInfo* target, unsigned int in1Duty, unsigned int in2Duty) {
+    const MotorDriveGPIO* motordrive = &target->motordrive;
+    int rc = set_PWM_dutycycle(pi, motordrive->in1, in1Duty);
+    if (rc >= 0) rc = set_PWM_dutycycle(pi, motordrive->in2, in2Duty);
+    if (rc < 0) {
 #ifdef DEBUG
-        debug_log(stderr, "[gpio invalid operation error]: Failed to write pwm to GPIO (%u, %u) \n", motordrive->in1, motordrive->in2);
+        log_event(LOG_WHEEL_PWM_FAILED, target->index, motordrive->in1, motordrive->in2, rc);
 #endif //DEBUG
-        return RC_INVALID_OPERATION;
+        return pigpiod_error_rc(rc);
     }
+    assert(target->index < ROBOT_MANAGED_WHEEL_COUNT);
+    lastDuty[target->index][0] = in1Duty;
+    lastDuty[target->index][1] = in2Duty;
     return RC_OK;
 }
 
@@ -93,7 +98,7 @@ int init_wheel(int pi, MotorDriveInfo* target) {
     }
 
     target->initialized = true;
-    return write_pwm(pi, &target->motordrive, 0, 0);
+    return write_pwm(pi, target, 0, 0);
 }
 
 int forward(int pi, const MotorDriveInfo* target, unsigned int duty) {
@@ -105,7 +110,7 @@ int forward(int pi, const MotorDriveInfo* target, unsigned int duty) {
     }
     
     duty = clamp_upper(duty, DUTYCYCLE_RANGE);
-    return write_pwm(pi, &target->motordrive, duty, 0);
+    return write_pwm(pi, target, duty, 0);
 }
 
 int reverse(int pi, const MotorDriveInfo* target, unsigned int duty) {
@@ -117,7 +122,7 @@ int reverse(int pi, const MotorDriveInfo* target, unsigned int duty) {
     }
 
     duty = clamp_upper(duty, DUTYCYCLE_RANGE);
-    return write_pwm(pi, &target->motordrive, 0, duty);
+    return write_pwm(pi, target, 0, duty);
 
 }
 
@@ -129,7 +134,7 @@ int idle(int pi, const MotorDriveInfo* target) {
         return RC_UNINITIALIZED;
     }
 
-    return write_pwm(pi, &target->motordrive, 0, 0);
+    return write_pwm(pi, target, 0, 0);
 }
 
 int brake(int pi, const MotorDriveInfo* target) {
@@ -140,5 +145,25 @@ int brake(int pi, const MotorDriveInfo* target) {
         return RC_UNINITIALIZED;
     }
 
-    return write_pwm(pi, &target->motordrive, DUTYCYCLE_RANGE, DUTYCYCLE_RANGE);
+    return write_pwm(pi, target, DUTYCYCLE_RANGE, DUTYCYCLE_RANGE);
+}
+
+int restore_wheel(int pi, const MotorDriveInfo* target) {
+    assert(target != NULL);
+    assert(pi >= 0);
+
+    if (!target->initialized) {
+        return RC_OK;
+    }
+
+    int rc;
+    rc = init_wheel_gpio(pi, target);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    rc = init_wheel_pwm(pi, target);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    return write_pwm(pi, target, lastDuty[target->index][0], lastDuty[target->index][1]);
 }
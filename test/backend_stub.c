@@ -0,0 +1,109 @@
+#include "backend_stub.h"
+#include <stdbool.h>
+
+#define STUB_GPIO_COUNT 64U
+#define STUB_CALLBACK_COUNT 32U
+#define STUB_HANDLE_COUNT 32U
+
+typedef struct {
+    unsigned int gpio;
+    unsigned int edge;
+    CBFuncEx_t f;
+    void* userdata;
+    bool active;
+} StubCallback;
+
+static unsigned int levels[STUB_GPIO_COUNT];
+static unsigned int duties[STUB_GPIO_COUNT];
+static StubCallback callbacks[STUB_CALLBACK_COUNT];
+static uint32_t currentTick;
+static uint32_t openHandles;
+static int commandError;
+
+void stub_edge(unsigned int gpio, unsigned int level, uint32_t tick) {
+    levels[gpio % STUB_GPIO_COUNT] = level;
+    currentTick = tick;
+    for (unsigned int i = 0; i < STUB_CALLBACK_COUNT; ++i) {
+        const StubCallback* cb = &callbacks[i];
+        if (!cb->active || cb->gpio != gpio) continue;
+        if ((cb->edge == RISING_EDGE && level == 0U) || (cb->edge == FALLING_EDGE && level != 0U)) continue;
+        cb->f(0, gpio, level, tick, cb->userdata);
+    }
+}
+
+void stub_set_level(unsigned int gpio, unsigned int level) {
+    levels[gpio % STUB_GPIO_COUNT] = level;
+}
+
+unsigned int stub_duty(unsigned int gpio) {
+    return duties[gpio % STUB_GPIO_COUNT];
+}
+
+void stub_set_error(int rc) {
+    commandError = rc;
+}
+
+unsigned int stub_open_handles(void) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < STUB_HANDLE_COUNT; ++i) {
+        if ((openHandles >> i) & 1U) ++count;
+    }
+    return count;
+}
+
+unsigned int stub_callback_count(void) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < STUB_CALLBACK_COUNT; ++i) {
+        if (callbacks[i].active) ++count;
+    }
+    return count;
+}
+
+//Hands out the lowest free handle, as pigpiod_if2 does
+int pigpio_start(const char* addrStr, const char* portStr) {
+    (void)addrStr;
+    (void)portStr;
+    for (unsigned int i = 0; i < STUB_HANDLE_COUNT; ++i) {
+        if (((openHandles >> i) & 1U) == 0U) {
+            openHandles |= 1U << i;
+            return (int)i;
+        }
+    }
+    return pigif_too_many_pis;
+}
+
+void pigpio_stop(int pi) {
+    if (pi >= 0 && (unsigned int)pi < STUB_HANDLE_COUNT) openHandles &= ~(1U << pi);
+}
+
+int set_mode(int pi, unsigned gpio, unsigned mode) { (void)pi; (void)gpio; (void)mode; return commandError; }
+int set_pull_up_down(int pi, unsigned gpio, unsigned pud) { (void)pi; (void)gpio; (void)pud; return commandError; }
+int gpio_read(int pi, unsigned gpio) { (void)pi; return commandError != 0 ? commandError : (int)levels[gpio % STUB_GPIO_COUNT]; }
+int set_PWM_frequency(int pi, unsigned user_gpio, unsigned frequency) { (void)pi; (void)user_gpio; return commandError != 0 ? commandError : (int)frequency; }
+int set_PWM_range(int pi, unsigned user_gpio, unsigned range_) { (void)pi; (void)user_gpio; return commandError != 0 ? commandError : (int)range_; }
+uint32_t get_current_tick(int pi) { (void)pi; return commandError != 0 ? (uint32_t)commandError : currentTick; }
+
+int set_PWM_dutycycle(int pi, unsigned user_gpio, unsigned dutycycle) {
+    (void)pi;
+    if (commandError != 0) return commandError;
+    duties[user_gpio % STUB_GPIO_COUNT] = dutycycle;
+    return 0;
+}
+
+int callback_ex(int pi, unsigned user_gpio, unsigned edge, CBFuncEx_t f, void* userdata) {
+    (void)pi;
+    if (commandError != 0) return commandError;
+    for (unsigned int i = 0; i < STUB_CALLBACK_COUNT; ++i) {
+        if (!callbacks[i].active) {
+            callbacks[i] = (StubCallback){.gpio = user_gpio, .edge = edge, .f = f, .userdata = userdata, .active = true};
+            return (int)i;
+        }
+    }
+    return pigif_bad_malloc;
+}
+
+int callback_cancel(unsigned callback_id) {
+    if (callback_id >= STUB_CALLBACK_COUNT || !callbacks[callback_id].active) return pigif_callback_not_found;
+    callbacks[callback_id].active = false;
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_TEST_BACKEND_STUB_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_TEST_BACKEND_STUB_H_
+
+#include <pigpiod_if2.h>
+
+/**
+ * @file backend_stub.h
+ * @brief In-process pigpiod_if2 replacement for the tests
+ *
+ * GPIO levels and PWM duties are held in memory and callbacks registered with callback_ex() are
+ * invoked by stub_edge(), so decoders and the reconnect path can be driven without a daemon
+*/
+
+/**
+ * @brief Set a GPIO level and run the callbacks registered for that edge
+ *
+ * @param gpio GPIO number
+ * @param level New level (0 or 1)
+ * @param tick Tick passed to the callbacks
+*/
+void stub_edge(unsigned int gpio, unsigned int level, uint32_t tick);
+
+/**
+ * @brief Set a GPIO level without running callbacks (e.g. movement while disconnected)
+ *
+ * @param gpio GPIO number
+ * @param level New level (0 or 1)
+*/
+void stub_set_level(unsigned int gpio, unsigned int level);
+
+/**
+ * @brief Last duty written to a GPIO with set_PWM_dutycycle()
+*/
+unsigned int stub_duty(unsigned int gpio);
+
+/**
+ * @brief Make every GPIO command fail with rc (0 restores normal operation)
+ *
+ * pigpio_start() and pigpio_stop() are not affected, so a reconnect succeeds while the replay fails
+*/
+void stub_set_error(int rc);
+
+/**
+ * @brief Number of callbacks currently registered
+*/
+unsigned int stub_callback_count(void);
+
+/**
+ * @brief Number of handles opened with pigpio_start() and not yet stopped
+*/
+unsigned int stub_open_handles(void);
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_TEST_BACKEND_STUB_H_
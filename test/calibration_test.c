@@ -0,0 +1,99 @@
+#include "mecanum/calibration.h"
+#include "check.h"
+#include <string.h>
+
+#define TEST_FILE "calibration_test.bin"
+
+//Linear motor with a deadband up to duty 60 and 5 pulses/s per duty above it
+static void motor_curve(float speed[CALIBRATION_STEPS + 1U]) {
+    for (unsigned int k = 0; k <= CALIBRATION_STEPS; ++k) {
+        float duty = (float)(k * DUTYCYCLE_RANGE) / (float)CALIBRATION_STEPS;
+        speed[k] = duty < 60.0f ? 0.0f : (duty - 60.0f) * 5.0f;
+    }
+}
+
+static int test_build_table(void) {
+    float speed[CALIBRATION_STEPS + 1U];
+    SpeedTable table;
+
+    motor_curve(speed);
+    speed[20] = speed[18];  //measurement dip, must not break the inversion
+    build_speed_table(speed, &table);
+
+    CHECK(table.max_speed > 0.0f);
+    CHECK(table.duty[0] > 0U && table.duty[0] < 60U);
+    CHECK(table.duty[CALIBRATION_LUT_SIZE - 1U] == DUTYCYCLE_RANGE);
+    for (unsigned int i = 1; i < CALIBRATION_LUT_SIZE; ++i) {
+        CHECK(table.duty[i] >= table.duty[i - 1U]);
+    }
+
+    CHECK(feedforward_duty(&table, 0.0f) == 0U);
+    CHECK(feedforward_duty(&table, table.max_speed * 2.0f) == DUTYCYCLE_RANGE);
+    unsigned int duty = feedforward_duty(&table, 250.0f);
+    CHECK(duty >= 108U && duty <= 112U);
+
+    //a wheel that never moves gives an empty table
+    (void)memset(speed, 0, sizeof(speed));
+    build_speed_table(speed, &table);
+    CHECK(table.max_speed == 0.0f);
+    CHECK(feedforward_duty(&table, 100.0f) == 0U);
+    return 0;
+}
+
+static int write_file(const uint8_t* data, size_t len) {
+    FILE* fp = fopen(TEST_FILE, "wb");
+    CHECK(fp != NULL);
+    CHECK(fwrite(data, 1, len, fp) == len);
+    CHECK(fclose(fp) == 0);
+    return 0;
+}
+
+static int test_file_round_trip(void) {
+    float speed[CALIBRATION_STEPS + 1U];
+    motor_curve(speed);
+    for (unsigned int i = 0; i < ROBOT_MANAGED_WHEEL_COUNT; ++i) {
+        build_speed_table(speed, &CALIBRATIONS[i].table[DIRECTION_FORWARD]);
+        build_speed_table(speed, &CALIBRATIONS[i].table[DIRECTION_REVERSE]);
+        CALIBRATIONS[i].calibrated = i != 1U;
+    }
+    WheelCalibration saved[ROBOT_MANAGED_WHEEL_COUNT];
+    (void)memcpy(saved, CALIBRATIONS, sizeof(saved));
+
+    CHECK(save_calibration(TEST_FILE) == RC_OK);
+    (void)memset(CALIBRATIONS, 0, sizeof(CALIBRATIONS));
+    CHECK(load_calibration(TEST_FILE) == RC_OK);
+    CHECK(memcmp(saved, CALIBRATIONS, sizeof(saved)) == 0);
+
+    uint8_t buf[4096];
+    FILE* fp = fopen(TEST_FILE, "rb");
+    CHECK(fp != NULL);
+    size_t len = fread(buf, 1, sizeof(buf), fp);
+    (void)fclose(fp);
+    CHECK(len > 16U && len < sizeof(buf));
+
+    //corrupted payload
+    buf[len / 2U] ^= 0x5A;
+    CHECK(write_file(buf, len) == 0);
+    (void)memset(CALIBRATIONS, 0, sizeof(CALIBRATIONS));
+    CHECK(load_calibration(TEST_FILE) == RC_INVALID_OPERATION);
+    CHECK(!CALIBRATIONS[0].calibrated);
+    buf[len / 2U] ^= 0x5A;
+
+    //truncated and over-long files
+    CHECK(write_file(buf, len - 1U) == 0);
+    CHECK(load_calibration(TEST_FILE) == RC_INVALID_OPERATION);
+    buf[len] = 0;
+    CHECK(write_file(buf, len + 1U) == 0);
+    CHECK(load_calibration(TEST_FILE) == RC_INVALID_OPERATION);
+
+    //missing file
+    (void)remove(TEST_FILE);
+    CHECK(load_calibration(TEST_FILE) == RC_INVALID_OPERATION);
+    return 0;
+}
+
+int main(void) {
+    if (test_build_table() != 0) return 1;
+    if (test_file_round_trip() != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef LMP_PROJECT_HARDWARE_MECANUM_TEST_CHECK_H_
+#define LMP_PROJECT_HARDWARE_MECANUM_TEST_CHECK_H_
+
+#include <stdio.h>
+
+/**
+ * @file check.h
+ * @brief Assertion for the test functions (returns 1 from the calling function on failure)
+*/
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s \n", __FILE__, __LINE__, #cond); \
+            return 1; \
+        } \
+    } while (0)
+
+#endif //LMP_PROJECT_HARDWARE_MECANUM_TEST_CHECK_H_
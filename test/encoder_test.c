@@ -1,5 +1,127 @@
-#include "mecanum/encoder.h"
+#include "encoder_internal.h"
+#include "backend_stub.h"
+#include "check.h"
+
+#define TEST_CH_A 5U
+#define TEST_CH_B 6U
+#define BURST_NS 200000LL     //Clock advance over a fast burst (12 X4 steps are 60000 edges/s)
+#define PAUSE_NS 20000000LL   //Clock advance of a quiet period
+
+//cw order of the (A, B) states
+static const unsigned int SEQUENCE[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+static unsigned int phase;
+static uint32_t tick = 1000;
+static int64_t nowNs;  //Clock given to update_encoder_mode_at()
+
+//Moves one X4 step (dir = 1 for cw, -1 for ccw) and fires the edge
+static void step(int dir) {
+    unsigned int next = (phase + (dir > 0 ? 1U : 3U)) & MASK_LOWER2;
+    bool aChanged = SEQUENCE[next][0] != SEQUENCE[phase][0];
+    phase = next;
+    tick += 2U * MIN_PULSE_US;
+    if (aChanged) stub_edge(TEST_CH_A, SEQUENCE[phase][0], tick);
+    else stub_edge(TEST_CH_B, SEQUENCE[phase][1], tick);
+}
+
+static void steps(int count, int dir) {
+    for (int i = 0; i < count; ++i) step(dir);
+}
+
+//Advances the clock and re-selects the mode
+static int update_after(EncoderInfo* enc, int64_t elapsedNs) {
+    nowNs += elapsedNs;
+    return update_encoder_mode_at(0, enc, nowNs);
+}
+
+static int test_fixed_modes(void) {
+    static const EncoderMultiplication MODES[3] = {X1, X2, X4};
+    for (unsigned int m = 0; m < 3; ++m) {
+        EncoderInfo enc = {.state = {.position = 0}, .encoder = {.cha = TEST_CH_A, .chb = TEST_CH_B}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1};
+        CHECK(init_encoder(0, &enc, MODES[m]) == RC_OK);
+        steps(16, 1);
+        CHECK(get_position(&enc) == 16 * (int)MODES[m] / 4);
+        steps(8, -1);
+        CHECK(get_position(&enc) == 8 * (int)MODES[m] / 4);
+        CHECK(deinit_encoder(0, &enc, true) == RC_OK);
+        CHECK(stub_callback_count() == 0U);
+    }
+    return 0;
+}
+
+//Switches X4 -> X2 -> X1 -> X2 -> X4 at every phase offset and checks the X4 count stays exact
+static int test_adaptive_switches(void) {
+    for (int dir = -1; dir <= 1; dir += 2) {
+        for (int offset = 0; offset < 4; ++offset) {
+            EncoderInfo enc = {.state = {.position = 0}, .encoder = {.cha = TEST_CH_A, .chb = TEST_CH_B}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1};
+            CHECK(init_encoder(0, &enc, XADAPTIVE) == RC_OK);
+            enc.rate.time_ns = nowNs;
+            CHECK(enc.mode == X4 && get_multiplier(&enc) == 4);
+            CHECK(stub_callback_count() == 2U);
+            int expected = 0;
+
+            //fast bursts step down one mode per update
+            steps(12 + offset, dir);
+            expected += (12 + offset) * dir;
+            CHECK(update_after(&enc, BURST_NS) == RC_OK);
+            CHECK(enc.mode == X2 && stub_callback_count() == 1U);
+            CHECK(get_position(&enc) == expected);
+
+            steps(9 + offset, dir);
+            expected += (9 + offset) * dir;
+            CHECK(update_after(&enc, BURST_NS) == RC_OK);
+            CHECK(enc.mode == X1 && stub_callback_count() == 1U);
+
+            //X1 only counts rising A edges, so compare at the next one
+            steps(13 + offset, dir);
+            expected += (13 + offset) * dir;
+            while (!(SEQUENCE[phase][0] == 1U && SEQUENCE[(phase + (dir > 0 ? 3U : 1U)) & MASK_LOWER2][0] == 0U)) {
+                step(dir);
+                expected += dir;
+            }
+            CHECK(get_position(&enc) == expected);
+
+            //quiet periods step back up
+            CHECK(update_after(&enc, PAUSE_NS) == RC_OK);
+            CHECK(enc.mode == X2);
+            steps(offset + 1, dir);
+            expected += (offset + 1) * dir;
+            CHECK(update_after(&enc, PAUSE_NS) == RC_OK);
+            CHECK(enc.mode == X4 && stub_callback_count() == 2U);
+
+            steps(11, dir);
+            expected += 11 * dir;
+            CHECK(get_position(&enc) == expected);
+
+            uint64_t residency[3];
+            get_mode_residency(&enc, residency);
+            CHECK(residency[0] == PAUSE_NS / 1000 && residency[1] == (BURST_NS + PAUSE_NS) / 1000 && residency[2] == BURST_NS / 1000);
+            CHECK(deinit_encoder(0, &enc, true) == RC_OK);
+            CHECK(stub_callback_count() == 0U);
+        }
+    }
+    return 0;
+}
+
+//Control cycles shorter than a microsecond apart must not be truncated away
+static int test_residency_precision(void) {
+    EncoderInfo enc = {.state = {.position = 0}, .encoder = {.cha = TEST_CH_A, .chb = TEST_CH_B}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1};
+    uint64_t residency[3];
+
+    CHECK(init_encoder(0, &enc, XADAPTIVE) == RC_OK);
+    enc.rate.time_ns = nowNs;
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(update_after(&enc, 1500) == RC_OK);
+    }
+    get_mode_residency(&enc, residency);
+    CHECK(enc.mode == X4 && residency[2] == 1500U && residency[0] == 0U && residency[1] == 0U);
+    CHECK(deinit_encoder(0, &enc, true) == RC_OK);
+    return 0;
+}
 
 int main(void) {
+    if (test_fixed_modes() != 0) return 1;
+    if (test_adaptive_switches() != 0) return 1;
+    if (test_residency_precision() != 0) return 1;
     return 0;
 }
@@ -0,0 +1,145 @@
+#include "log_internal.h"
+#include "check.h"
+#include <pthread.h>
+#include <string.h>
+
+#define TEST_FILE "log_test.bin"
+#define NS_PER_SEC 1000000000ULL
+
+static int test_format(void) {
+    char line[256];
+    LogEvent ev = {.time_ns = 3 * NS_PER_SEC + 250000000ULL, .rc = -5, .event = LOG_WHEEL_PWM_FAILED, .index = 1, .pin_a = 22, .pin_b = 23};
+
+    CHECK(format_log_event(&ev, line, sizeof(line)) > 0);
+    CHECK(strncmp(line, "[3.250000]", 10) == 0);
+    CHECK(strstr(line, "(22, 23)") != NULL && strstr(line, "rc = -5") != NULL);
+
+    ev.event = LOG_EVENT_SUPPRESSED;
+    ev.index = LOG_WHEEL_UNINITIALIZED;
+    ev.rc = 7;
+    CHECK(format_log_event(&ev, line, sizeof(line)) > 0);
+    CHECK(strstr(line, "7 events of id 1 suppressed") != NULL);
+
+    ev.event = 200;
+    CHECK(format_log_event(&ev, line, sizeof(line)) > 0);
+    CHECK(strstr(line, "Unknown event 200") != NULL);
+    return 0;
+}
+
+//Events written by the logger thread are read back the way mecanum_log_decode does
+static int test_binary_round_trip(void) {
+    const unsigned int total = LOG_RATE_LIMIT + 10U;
+    FILE* fp = fopen(TEST_FILE, "wb");
+    CHECK(fp != NULL);
+    CHECK(start_logger(fp, LOG_FORMAT_BINARY) == RC_OK);
+    CHECK(start_logger(fp, LOG_FORMAT_BINARY) == RC_ALREADY_INITIALIZED);
+    for (unsigned int i = 0; i < total; ++i) {
+        log_event(LOG_WHEEL_PWM_FAILED, 2, 24, 25, -(int)i);
+    }
+    stop_logger();
+    CHECK(fclose(fp) == 0);
+    CHECK(get_log_dropped() == 0U);
+
+    fp = fopen(TEST_FILE, "rb");
+    CHECK(fp != NULL);
+    LogFileHeader header;
+    CHECK(fread(&header, sizeof(header), 1, fp) == 1);
+    CHECK(header.magic == LOG_FILE_MAGIC && header.version == LOG_FILE_VERSION && header.record_size == sizeof(LogEvent));
+
+    LogEvent ev;
+    unsigned int written = 0, suppressed = 0;
+    uint64_t lastTime = 0;
+    char line[256];
+    while (fread(&ev, sizeof(ev), 1, fp) == 1) {
+        CHECK(format_log_event(&ev, line, sizeof(line)) > 0);
+        if (ev.event == LOG_EVENT_SUPPRESSED) {
+            CHECK(ev.index == LOG_WHEEL_PWM_FAILED);
+            suppressed += (unsigned int)ev.rc;
+            continue;
+        }
+        CHECK(ev.event == LOG_WHEEL_PWM_FAILED && ev.index == 2 && ev.pin_a == 24 && ev.pin_b == 25);
+        CHECK(ev.rc <= 0 && ev.time_ns >= lastTime);
+        lastTime = ev.time_ns;
+        ++written;
+    }
+    (void)fclose(fp);
+    (void)remove(TEST_FILE);
+
+    //The burst may straddle a second boundary, so only the sum is fixed
+    CHECK(written >= LOG_RATE_LIMIT && written + suppressed == total);
+    return 0;
+}
+
+static LogEvent captured[LOG_RATE_LIMIT + 8U];
+static unsigned int capturedCount;
+
+static void capture(const LogEvent* ev) {
+    if (capturedCount < sizeof(captured) / sizeof(captured[0])) captured[capturedCount] = *ev;
+    ++capturedCount;
+}
+
+//An older event from another ring must not reopen the previous window
+static int test_window_forward_only(void) {
+    RateLimit limit = {.window = 0, .write = capture};
+    LogEvent newer = {.time_ns = 11 * NS_PER_SEC, .event = LOG_WHEEL_PWM_FAILED};
+    LogEvent older = {.time_ns = 10 * NS_PER_SEC + 900000000ULL, .event = LOG_WHEEL_PWM_FAILED};
+
+    capturedCount = 0;
+    for (unsigned int i = 0; i < LOG_RATE_LIMIT; ++i) {
+        rate_limit_consume(&limit, (i & 1U) != 0U ? &older : &newer);
+    }
+    CHECK(limit.window == 11U && limit.written[LOG_WHEEL_PWM_FAILED] == LOG_RATE_LIMIT);
+    rate_limit_consume(&limit, &older);
+    rate_limit_consume(&limit, &newer);
+    CHECK(limit.suppressed[LOG_WHEEL_PWM_FAILED] == 2U && capturedCount == LOG_RATE_LIMIT);
+
+    //the next window writes the summary first
+    LogEvent next = {.time_ns = 12 * NS_PER_SEC, .event = LOG_WHEEL_PWM_FAILED};
+    rate_limit_consume(&limit, &next);
+    CHECK(limit.window == 12U && limit.written[LOG_WHEEL_PWM_FAILED] == 1U && limit.suppressed[LOG_WHEEL_PWM_FAILED] == 0U);
+    CHECK(capturedCount == LOG_RATE_LIMIT + 2U);
+    CHECK(captured[LOG_RATE_LIMIT].event == LOG_EVENT_SUPPRESSED && captured[LOG_RATE_LIMIT].index == LOG_WHEEL_PWM_FAILED);
+    CHECK(captured[LOG_RATE_LIMIT].rc == 2 && captured[LOG_RATE_LIMIT].time_ns == next.time_ns);
+    CHECK(captured[LOG_RATE_LIMIT + 1U].time_ns == next.time_ns);
+    return 0;
+}
+
+static void* log_once(void* arg) {
+    UNUSED_PARAMETER(arg);
+    log_event(LOG_WHEEL_UNINITIALIZED, 0, 0, 0, RC_UNINITIALIZED);
+    return NULL;
+}
+
+//Threads that come and go reuse the rings of the threads that exited
+static int test_ring_reuse(void) {
+    FILE* fp = tmpfile();
+    CHECK(fp != NULL);
+    CHECK(start_logger(fp, LOG_FORMAT_TEXT) == RC_OK);
+    log_event(LOG_WHEEL_UNINITIALIZED, 0, 0, 0, RC_UNINITIALIZED);
+    unsigned int rings = log_ring_count();
+
+    for (int i = 0; i < 32; ++i) {
+        pthread_t thread;
+        CHECK(pthread_create(&thread, NULL, log_once, NULL) == 0);
+        CHECK(pthread_join(thread, NULL) == 0);
+    }
+    CHECK(log_ring_count() <= rings + 1U);
+    stop_logger();
+
+    //every event reached the file: 1 + 32 lines
+    char line[256];
+    unsigned int lines = 0;
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) ++lines;
+    (void)fclose(fp);
+    CHECK(lines == 33U);
+    return 0;
+}
+
+int main(void) {
+    if (test_format() != 0) return 1;
+    if (test_binary_round_trip() != 0) return 1;
+    if (test_window_forward_only() != 0) return 1;
+    if (test_ring_reuse() != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "mecanum/mecanum.hpp"
+#include "check.h"
+
+extern "C" {
+#include "backend_stub.h"
+}
+
+namespace {
+
+constexpr unsigned int kChA = 5;
+constexpr unsigned int kChB = 6;
+
+//cw order of the (A, B) states
+constexpr unsigned int SEQUENCE[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+unsigned int phase;
+uint32_t tick = 1000;
+
+//Moves one X4 step (dir = 1 for cw, -1 for ccw) and fires the edge
+void step(int dir) {
+    unsigned int next = (phase + (dir > 0 ? 1U : 3U)) & MASK_LOWER2;
+    bool aChanged = SEQUENCE[next][0] != SEQUENCE[phase][0];
+    phase = next;
+    tick += 2U * MIN_PULSE_US;
+    if (aChanged) stub_edge(kChA, SEQUENCE[phase][0], tick);
+    else stub_edge(kChB, SEQUENCE[phase][1], tick);
+}
+
+void steps(int count, int dir) {
+    for (int i = 0; i < count; ++i) step(dir);
+}
+
+//Construct/destruct callback counts, decoding and restore() without movement for one mode
+template <EncoderMultiplication Mode>
+int test_encoder(unsigned int callbacks) {
+    phase = 0;
+    stub_set_level(kChA, 0);
+    stub_set_level(kChB, 0);
+    {
+        mecanum::Encoder<kChA, kChB, Mode> enc(0);
+        CHECK(enc.status() == RC_OK);
+        CHECK(stub_callback_count() == callbacks);
+
+        steps(16, 1);
+        CHECK(enc.position() == 16 * static_cast<int>(Mode) / 4);
+        steps(8, -1);
+        CHECK(enc.position() == 8 * static_cast<int>(Mode) / 4);
+
+        //one cycle plus a step, then a reconnect with the encoder at rest
+        steps(5, 1);
+        int32_t position = enc.position();
+        bool gap = true;
+        CHECK(enc.restore(0, &gap) == RC_OK);
+        CHECK(!gap && enc.position() == position);
+        CHECK(stub_callback_count() == callbacks);
+        steps(4, 1);
+        CHECK(enc.position() == position + static_cast<int>(Mode));
+    }
+    CHECK(stub_callback_count() == 0U);
+    return 0;
+}
+
+int test_wheel() {
+    mecanum::Wheel<12, 16> wheel(0);
+    CHECK(wheel.status() == RC_OK);
+    CHECK(wheel.reverse(300) == RC_OK);
+    CHECK(stub_duty(12) == 0U && stub_duty(16) == DUTYCYCLE_RANGE);
+
+    stub_set_error(pigif_bad_send);
+    CHECK(wheel.forward(10) == RC_DAEMON_DISCONNECTED);
+    CHECK(wheel.restore(0) == RC_DAEMON_DISCONNECTED);
+    stub_set_error(0);
+    CHECK(set_PWM_dutycycle(0, 16, 0) == 0);
+
+    CHECK(wheel.restore(0) == RC_OK && wheel.status() == RC_OK);
+    CHECK(stub_duty(12) == 0U && stub_duty(16) == DUTYCYCLE_RANGE);
+    return 0;
+}
+
+int test_platform() {
+    {
+        mecanum::Platform<1, X2> platform(0);
+        CHECK(platform.status() == RC_OK);
+        CHECK(stub_callback_count() == 1U);
+        CHECK(platform.drive({{-40}}) == RC_OK);
+        uint32_t mask = 1;
+        CHECK(platform.restore(0, &mask) == RC_OK && mask == 0U);
+        CHECK(stub_callback_count() == 1U);
+    }
+    CHECK(stub_callback_count() == 0U);
+    return 0;
+}
+
+} //namespace
+
+int main() {
+    if (test_encoder<X1>(1) != 0) return 1;
+    if (test_encoder<X2>(1) != 0) return 1;
+    if (test_encoder<X4>(2) != 0) return 1;
+    if (test_wheel() != 0) return 1;
+    if (test_platform() != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L //sigaction
+
+#include "mecanum/recovery.h"
+#include "backend_stub.h"
+#include "check.h"
+#include <signal.h>
+
+#define TEST_IN1 12U
+#define TEST_IN2 16U
+#define TEST_CH_A 22U
+#define TEST_CH_B 23U
+
+//cw order of the (A, B) states
+static const unsigned int SEQUENCE[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+static unsigned int phase;
+static uint32_t tick = 1000;
+
+//Moves one X4 step cw and fires the edge
+static void step_cw(void) {
+    unsigned int next = (phase + 1U) & MASK_LOWER2;
+    bool aChanged = SEQUENCE[next][0] != SEQUENCE[phase][0];
+    phase = next;
+    tick += 2U * MIN_PULSE_US;
+    if (aChanged) stub_edge(TEST_CH_A, SEQUENCE[phase][0], tick);
+    else stub_edge(TEST_CH_B, SEQUENCE[phase][1], tick);
+}
+
+//Moves the pins by count X4 steps cw without delivering the edges (outage)
+static void move_silently(unsigned int count) {
+    phase = (phase + count) & MASK_LOWER2;
+    stub_set_level(TEST_CH_A, SEQUENCE[phase][0]);
+    stub_set_level(TEST_CH_B, SEQUENCE[phase][1]);
+}
+
+static int test_sigpipe(void) {
+    struct sigaction sa;
+    int pi = pigpiod_daemon_open(LOCALHOST, DEFAULT_PORT);
+    CHECK(pi >= 0);
+    CHECK(sigaction(SIGPIPE, NULL, &sa) == 0 && sa.sa_handler == SIG_IGN);
+    pigpiod_daemon_close(pi);
+    CHECK(stub_open_handles() == 0U);
+    return 0;
+}
+
+static int test_restore_wheel(void) {
+    MotorDriveInfo wheel = {.motordrive = {.in1 = TEST_IN1, .in2 = TEST_IN2}, .initialized = false, .index = 1};
+    CHECK(init_wheel(0, &wheel) == RC_OK);
+    CHECK(reverse(0, &wheel, 120) == RC_OK);
+    CHECK(stub_duty(TEST_IN1) == 0U && stub_duty(TEST_IN2) == 120U);
+
+    //a restarted daemon comes back with the outputs at 0
+    stub_set_error(pigif_bad_send);
+    CHECK(forward(0, &wheel, 80) == RC_DAEMON_DISCONNECTED);
+    CHECK(restore_wheel(0, &wheel) == RC_DAEMON_DISCONNECTED);
+    stub_set_error(0);
+    CHECK(set_PWM_dutycycle(0, TEST_IN2, 0) == 0);
+
+    //the last successful command is replayed
+    CHECK(restore_wheel(0, &wheel) == RC_OK);
+    CHECK(stub_duty(TEST_IN1) == 0U && stub_duty(TEST_IN2) == 120U);
+    CHECK(idle(0, &wheel) == RC_OK);
+    return 0;
+}
+
+//Runs one cycle plus a step, restores without movement, then after lost steps and after two more
+static int test_restore_encoder(EncoderMultiplication mode, int32_t expected, unsigned int lost, bool lostIsGap) {
+    EncoderInfo enc = {.state = {.position = 0}, .encoder = {.cha = TEST_CH_A, .chb = TEST_CH_B}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1};
+    bool counted = mode == X4 || mode == XADAPTIVE;
+    bool gap = true;
+
+    move_silently((4U - phase) & MASK_LOWER2);
+    CHECK(init_encoder(0, &enc, mode) == RC_OK);
+    for (int i = 0; i < 5; ++i) step_cw();
+    CHECK(get_position(&enc) == expected);
+
+    unsigned int callbacks = stub_callback_count();
+    CHECK(restore_encoder(0, &enc, &gap) == RC_OK);
+    CHECK(!gap && get_position(&enc) == expected);
+    CHECK(stub_callback_count() == callbacks);
+
+    move_silently(lost);
+    CHECK(restore_encoder(0, &enc, &gap) == RC_OK);
+    CHECK(gap == lostIsGap);
+    if (counted && !lostIsGap) expected += (int32_t)lost;
+    CHECK(get_position(&enc) == expected);
+
+    //two steps flip channel A, which every mode sees
+    move_silently(2);
+    CHECK(restore_encoder(0, &enc, &gap) == RC_OK);
+    CHECK(gap && get_position(&enc) == expected);
+
+    //decoding continues on the restored callbacks
+    for (int i = 0; i < 4; ++i) step_cw();
+    CHECK(get_position(&enc) == expected + get_multiplier(&enc));
+    CHECK(deinit_encoder(0, &enc, true) == RC_OK);
+    CHECK(stub_callback_count() == 0U);
+    return 0;
+}
+
+static int test_init_encoder_disconnected(void) {
+    EncoderInfo enc = {.state = {.position = 0}, .encoder = {.cha = TEST_CH_A, .chb = TEST_CH_B}, .mode = UNSET, .callback_id_a = -1, .callback_id_b = -1};
+    stub_set_error(pigif_unconnected_pi);
+    CHECK(init_encoder(0, &enc, X4) == RC_DAEMON_DISCONNECTED);
+    stub_set_error(pigif_bad_callback);
+    CHECK(init_encoder(0, &enc, X4) == RC_INVALID_OPERATION);
+    stub_set_error(0);
+    CHECK(!enc.initialized && stub_callback_count() == 0U);
+    return 0;
+}
+
+static int test_recover_daemon(void) {
+    RecoveryReport report;
+    int pi = pigpiod_daemon_open(LOCALHOST, DEFAULT_PORT);
+    CHECK(pi >= 0);
+    CHECK(init_wheel(pi, &WHEELS[0]) == RC_OK);
+    CHECK(init_encoder(pi, &ENCODERS[0], X4) == RC_OK);
+    set_position(&ENCODERS[0], 1234);
+
+    //the connection drops again during the replay: the new handle is not leaked
+    stub_set_error(pigif_bad_send);
+    CHECK(forward(pi, &WHEELS[0], 50) == RC_DAEMON_DISCONNECTED);
+    CHECK(recover_daemon(pi, &report) == RC_DAEMON_DISCONNECTED);
+    CHECK(report.attempts == 1U);
+    CHECK(stub_open_handles() == 0U);
+
+    //a replay failure that is not a lost socket
+    stub_set_error(pigif_bad_callback);
+    CHECK(recover_daemon(-1, NULL) == RC_INVALID_OPERATION);
+    CHECK(stub_open_handles() == 0U);
+
+    stub_set_error(0);
+    pi = recover_daemon(-1, &report);
+    CHECK(pi >= 0);
+    CHECK(stub_open_handles() == 1U);
+    CHECK(report.attempts == 1U && report.edge_gap_mask == 0U);
+    CHECK(get_position(&ENCODERS[0]) == 1234);
+    CHECK(stub_callback_count() == 2U);
+
+    CHECK(deinit_encoder(pi, &ENCODERS[0], true) == RC_OK);
+    pigpiod_daemon_close(pi);
+    CHECK(stub_open_handles() == 0U);
+    return 0;
+}
+
+int main(void) {
+    if (test_sigpipe() != 0) return 1;
+    if (test_restore_wheel() != 0) return 1;
+    //a falling A edge is not counted in X1 and a B edge not in X2, so neither is a gap
+    if (test_restore_encoder(X1, 2, 2, false) != 0) return 1;
+    if (test_restore_encoder(X2, 3, 1, false) != 0) return 1;
+    if (test_restore_encoder(X2, 3, 3, true) != 0) return 1;
+    if (test_restore_encoder(X4, 5, 1, false) != 0) return 1;
+    if (test_restore_encoder(X4, 5, 2, true) != 0) return 1;
+    if (test_restore_encoder(XADAPTIVE, 5, 1, false) != 0) return 1;
+    if (test_init_encoder_disconnected() != 0) return 1;
+    if (test_recover_daemon() != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "timesync_internal.h"
+#include "check.h"
+
+#define ROUND_US 20000U            //Daemon time between rounds
+#define HOST_BASE_NS 5000000000LL  //Host time at the first round
+#define RTT_NS 100000LL            //Round trip of a good sample
+
+//Daemon clock running 50 ppm fast against the host clock
+static int64_t host_at(int64_t elapsedUs) {
+    return HOST_BASE_NS + (int64_t)((double)elapsedUs * 1000.0 / (1.0 + 50e-6));
+}
+
+static int feed(SyncFilter* f, uint32_t firstTick, unsigned int from, unsigned int to) {
+    for (unsigned int i = from; i < to; ++i) {
+        int64_t elapsed = (int64_t)i * ROUND_US;
+        CHECK(sync_filter_add(f, firstTick + (uint32_t)elapsed, host_at(elapsed), RTT_NS) == SYNC_ACCEPTED);
+    }
+    return 0;
+}
+
+static int test_tick_error(void) {
+    CHECK(is_tick_error((uint32_t)pigif_bad_send));
+    CHECK(is_tick_error((uint32_t)pigif_bad_recv));
+    CHECK(is_tick_error((uint32_t)pigif_unconnected_pi));
+    CHECK(!is_tick_error(0U));
+    CHECK(!is_tick_error(0xFFFFFFFFU));
+    CHECK(!is_tick_error(0x80000000U));
+    return 0;
+}
+
+static int test_fit(void) {
+    SyncFilter f;
+    sync_filter_reset(&f);
+    CHECK(feed(&f, 1000000U, 0, 40) == 0);
+    CHECK(f.count == TIME_SYNC_WINDOW && f.model.rounds == TIME_SYNC_WINDOW);
+    CHECK(fabs(f.model.nsPerUs * (1.0 + 50e-6) - 1000.0) < 1e-3);
+
+    //a tick between the rounds maps onto the host clock within a microsecond
+    int64_t elapsed = 39 * (int64_t)ROUND_US - 1234;
+    int64_t host = model_host_ns(&f.model, model_ext(&f.model, 1000000U + (uint32_t)elapsed));
+    CHECK(llabs(host - host_at(elapsed)) < 1000);
+    return 0;
+}
+
+static int test_extend_across_wrap(void) {
+    const uint32_t first = 0xFFFF0000U;  //wraps after about 65 ms
+    SyncFilter f;
+    sync_filter_reset(&f);
+    CHECK(feed(&f, first, 0, 8) == 0);
+
+    int64_t lastElapsed = 7 * (int64_t)ROUND_US;
+    CHECK(f.lastTick == first + (uint32_t)lastElapsed && f.lastTick < first);
+    CHECK(f.lastExt == (int64_t)first + lastElapsed);
+    CHECK(f.lastExt > (int64_t)UINT32_MAX);
+
+    //ticks on both sides of the wrap extend relative to the newest round
+    CHECK(model_ext(&f.model, 0xFFFFFF00U) == 0xFFFFFF00LL);
+    CHECK(model_ext(&f.model, 0x00000100U) == 0x100000100LL);
+
+    int64_t host = model_host_ns(&f.model, model_ext(&f.model, 0x00000100U));
+    CHECK(llabs(host - host_at(0x100000100LL - first)) < 1000);
+    return 0;
+}
+
+static int test_lost_and_dropped(void) {
+    SyncFilter f;
+    sync_filter_reset(&f);
+    CHECK(feed(&f, 1000U, 0, 4) == 0);
+
+    //slow round trips are dropped without touching the fit
+    CHECK(sync_filter_add(&f, 1000U + 4U * ROUND_US, host_at(4 * ROUND_US), (int64_t)TIME_SYNC_MAX_RTT_US * 1000 + 1) == SYNC_DROPPED);
+    CHECK(f.count == 4U);
+
+    //a frozen tick (daemon stopped answering with fresh values) resets the filter
+    CHECK(sync_filter_add(&f, f.lastTick, host_at(4 * ROUND_US), RTT_NS) == SYNC_LOST);
+    CHECK(f.count == 0U && !f.haveExt);
+
+    CHECK(feed(&f, 1000U, 5, 8) == 0);
+    CHECK(f.lastExt == 1000 + 7 * (int64_t)ROUND_US);
+
+    //an error code returned in place of a tick resets it as well
+    CHECK(sync_filter_add(&f, (uint32_t)pigif_bad_recv, host_at(8 * ROUND_US), RTT_NS) == SYNC_LOST);
+    CHECK(f.count == 0U && !f.haveExt);
+    return 0;
+}
+
+static int test_step_reset(void) {
+    const int64_t stepNs = (int64_t)TIME_SYNC_STEP_US * 2000;
+    SyncFilter f;
+    sync_filter_reset(&f);
+    CHECK(feed(&f, 1000U, 0, 10) == 0);
+
+    //an isolated outlier is dropped and the next good round clears the step count
+    CHECK(sync_filter_add(&f, 1000U + 10U * ROUND_US, host_at(10 * ROUND_US) + stepNs, RTT_NS) == SYNC_DROPPED);
+    CHECK(f.steps == 1U && f.count == 10U);
+    CHECK(feed(&f, 1000U, 11, 12) == 0);
+    CHECK(f.steps == 0U && f.count == 11U);
+
+    //a persistent one restarts the fit from the round that confirmed it
+    for (unsigned int i = 12; i < 12U + TIME_SYNC_STEP_COUNT; ++i) {
+        int64_t elapsed = (int64_t)i * ROUND_US;
+        SyncResult expected = i + 1U < 12U + TIME_SYNC_STEP_COUNT ? SYNC_DROPPED : SYNC_RESTARTED;
+        CHECK(sync_filter_add(&f, 1000U + (uint32_t)elapsed, host_at(elapsed) + stepNs, RTT_NS) == expected);
+    }
+    CHECK(f.count == 1U && f.steps == 0U && f.haveExt);
+    return 0;
+}
+
+int main(void) {
+    if (test_tick_error() != 0) return 1;
+    if (test_fit() != 0) return 1;
+    if (test_extend_across_wrap() != 0) return 1;
+    if (test_lost_and_dropped() != 0) return 1;
+    if (test_step_reset() != 0) return 1;
+    return 0;
+}
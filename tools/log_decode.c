@@ -0,0 +1,33 @@
+/**
+ * @file log_decode.c
+ * @brief Prints a LOG_FORMAT_BINARY log as text
+ *
+ * usage: mecanum_log_decode <file>   (reads stdin without an argument)
+*/
+
+#include "mecanum/log.h"
+
+int main(int argc, char** argv) {
+    FILE* fp = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (fp == NULL) {
+        fprintf(stderr, "mecanum_log_decode: cannot open %s \n", argv[1]);
+        return 1;
+    }
+
+    LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != LOG_FILE_MAGIC
+        || header.version != LOG_FILE_VERSION || header.record_size != sizeof(LogEvent)) {
+        fprintf(stderr, "mecanum_log_decode: not a mecanum log (or another version) \n");
+        return 1;
+    }
+
+    LogEvent ev;
+    char line[256];
+    while (fread(&ev, sizeof(ev), 1, fp) == 1) {
+        (void)format_log_event(&ev, line, sizeof(line));
+        (void)fputs(line, stdout);
+    }
+
+    if (fp != stdin) (void)fclose(fp);
+    return 0;
+}